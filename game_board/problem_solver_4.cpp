@@ -22,7 +22,10 @@ const char* largeDataset = "large_problem_set_4.in";
 
 const char*  helpMsg = "Please, indicate which problem set to use.\n\n"
                        "For small problem set, type: ./problem_solver_4 small\n"
-                       "For large problem set, type: ./problem_solver_4 large\n";
+                       "For large problem set, type: ./problem_solver_4 large\n"
+                       "To solve each problem as soon as it is read, add --stream\n"
+                       "To solve problems on all cores while reading, add --pipeline\n"
+                       "To set the number of solver threads, add --threads=N\n";
 
 const char* strNotice = "##################################\n"
                         "# Do not edit this file!\n"
@@ -36,6 +39,16 @@ struct ProblemN4: public TestFramework::BasicProblem
    int fee;
 };
 
+struct ProblemN4Schema
+{
+   static constexpr auto Fields()
+   {
+      return std::tuple_cat(TestFramework::DefaultProblemFields<ProblemN4>(), std::make_tuple(
+                TestFramework::MakeField<ProblemN4, std::vector<int>>("prices", &ProblemN4::prices),
+                TestFramework::MakeField<ProblemN4, int>("fee", &ProblemN4::fee)));
+   }
+};
+
 int main(int argc, char *argv[])
 {
    using namespace TestFramework;
@@ -43,6 +56,10 @@ int main(int argc, char *argv[])
    static_assert (GetTestFrameworkVersion () == 7,
       "TestFramework version 7 is required. Please, update test_framework.h.");
 
+   bool bStream = ExtractFlag(argc, argv, "--stream");
+   bool bPipeline = ExtractFlag(argc, argv, "--pipeline");
+   size_t nThreads = ExtractThreadCount(argc, argv);
+
    ExitIfConditionFails((argc == 2) || (argc == 3), helpMsg);
    std::string firstArg(argv[1]);
 
@@ -56,11 +73,7 @@ int main(int argc, char *argv[])
    AddDefaultProblemSetColumns(psAdapter);
 
    std::vector<ProblemN4> problems;
-   TableAdapter<ProblemN4> prAdapter(problems);
-   AddDefaultProblemColumns(prAdapter);
-
-   AddColumn<ProblemN4>(prAdapter, "prices", &ProblemN4::prices);
-   AddColumn<ProblemN4>(prAdapter, "fee", &ProblemN4::fee);
+   StaticTableAdapter<ProblemN4, ProblemN4Schema> prAdapter(problems);
 
    BasicYamlParser parser(dynamic_cast<ITable*>(&psAdapter),
                           dynamic_cast<ITable*>(&prAdapter));
@@ -68,30 +81,53 @@ int main(int argc, char *argv[])
    const char* inputFilename = bSmallDataset ? smallDataset : largeDataset;
    std::cout << "File: " << inputFilename << ".\n";
 
-   parser.ParseFile(inputFilename, true);
-   GetStudentName(header.student_name);
-   PreprocessProblemSet(problem_set_id, problems, header);
-
-   for (int i = 0; i < (int) problems.size(); ++i)
+   auto solve = [](ProblemN4& theProblem)
    {
-      auto& theProblem = problems[i];
+      theProblem.input_size = (int) theProblem.prices.size();
       theProblem.student_answer = MinCost(theProblem.prices, theProblem.fee);
+   };
+
+   const char* outputFilename = (argc == 3) ? argv[2] : nullptr;
+   TableAdapter<ProblemN4> prOutAdapter(problems);
+   AddDefaultProblemColumnsForOutput(prOutAdapter);
+
+   if (bPipeline)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetPipelined(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice, nThreads);
+   }
+   else if (bStream)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetStreaming(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice);
    }
+   else
+   {
+      parser.ParseFileCached(inputFilename, true);
+      GetStudentName(header.student_name);
+      PreprocessProblemSet(problem_set_id, problems, header);
 
-   ProcessResults(problems, header);
+      std::vector<WorkerStats> workerStats = ParallelSolve(problems, solve, nThreads);
+
+      ProcessResults(problems, header);
+      ReportWorkerStats(workerStats);
+   }
 
    std::cout << "Don't forget to submit your source code on Canvas.";
    std::cout << std::endl << std::endl;
 
-   if (argc == 3)
+   if (outputFilename != nullptr)
    {
-      const char * outputFilename = argv[2];
       std::cout << "Generating a report. ";
       std::cout << "The report is saved in file '" << outputFilename << "'.\n";
-      TableAdapter<ProblemN4> prOutAdapter(problems);
-      AddDefaultProblemColumnsForOutput(prOutAdapter);
 
-      WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      //the streaming modes write the report as they go
+      if (!bStream && !bPipeline)
+      {
+         WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      }
    }
 
    return 0;
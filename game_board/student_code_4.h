@@ -18,8 +18,8 @@
 
 
 //you can include standard C++ libraries here
-#include <math.h>
-#include <unordered_map>
+#include <cstdint>
+#include <limits>
 #include "test_framework.h"
 #include <iostream>
 // This function should return your name.
@@ -32,58 +32,62 @@ void GetStudentName(std::string& your_name)
    your_name.assign("Enter Here");
 }
 
-int min(int a, int b)
+// Cost of buying item i (1-based) on its own: the 10% discount of a single
+// purchase plus the fee
+int SingleCost(const std::vector<int>& prices, int i, int f)
 {
-	if (a < b) {
-		return a;
-	}
-	else { // a >= b
-		return b;
-	}
+	return prices[i - 1] - prices[i - 1] / 10 + f;
 }
 
-int OPTF(int num, std::unordered_map<int, int> memo, std::unordered_map<int, int> pricevec, int f) {
-	if (memo[num] == -1) {
-		if (num >= 5) { 
-			memo[num] = min((std::floor(pricevec[num] - (pricevec[num]/10)) + f) + OPTF(num - 1, memo, pricevec, f),
-				f + pricevec[num] + pricevec[num - 1] + pricevec[num - 2] + pricevec[num - 3] + pricevec[num - 4] + OPTF(num - 5, memo, pricevec, f));
-		
+// Bottom-up table of OPT[0..n]:
+//    OPT[i] = min(OPT[i - 1] + single cost of item i,
+//                 OPT[i - 5] + f + full price of items i - 4..i)
+// Cell is the width of the table entries; sums are formed in long long and
+// clamped to the range of Cell. Returns false if any entry had to be clamped.
+template<class Cell>
+bool OPTF(const std::vector<int>& prices, int f, std::vector<Cell>& OPT)
+{
+	const long long high = std::numeric_limits<Cell>::max();
+	const long long low = std::numeric_limits<Cell>::min();
+	const int n = (int)prices.size();
+	bool exact = true;
+	OPT.assign(n + 1, 0);
+	for (int i = 1; i <= n; i++) {
+		long long best = (long long)OPT[i - 1] + SingleCost(prices, i, f);
+		if (i >= 5) {
+			long long bundle = (long long)OPT[i - 5] + f + prices[i - 1] + prices[i - 2] +
+				prices[i - 3] + prices[i - 4] + prices[i - 5];
+			best = best < bundle ? best : bundle;
 		}
-		else {
-			memo[num] = std::floor(pricevec[num] - (pricevec[num] / 10)) + f + OPTF(num - 1, memo, pricevec, f);
+		if (best > high || best < low) {
+			exact = false;
+			best = best > high ? high : low;
 		}
+		OPT[i] = (Cell)best;
 	}
-
-	return memo[num];
+	return exact;
 }
+
+// Every entry of the table is at most the cost of buying all items one by
+// one, so 16-bit cells are used when that bound fits (and nothing is
+// negative). A narrow table that still overflows is redone with int cells.
 int MinCost(const std::vector<int>& prices, int fee)
 {
-	/*std::vector<int> OPT;
-	for (int i = 0; i < prices.size()+1; i++) {
-		OPT.push_back(-1);
-	}
-	OPT[0] = 0;
-	*/
-	std::unordered_map<int, int> OPT;
-	OPT[0] = 0;
-	for (int i = 1; i < prices.size()+1; i++) {
-		OPT[i] = -1;
-	}
-	/*
-	std::vector<int> prices_fitted;
-	prices_fitted.push_back(0);
-	for (int i = 0; i < prices.size(); i++) {
-		prices_fitted.push_back(prices[i]);
-	}
-	*/
-	std::unordered_map<int, int> price_map;
-	price_map[0] = 0;
-	for (int i = 1; i < prices.size() + 1; i++) {
-		price_map[i] = prices[i-1];
+	long long bound = 0;
+	bool nonNegative = (fee >= 0);
+	for (int i = 1; i <= (int)prices.size(); i++) {
+		nonNegative = nonNegative && (prices[i - 1] >= 0);
+		bound += SingleCost(prices, i, fee);
 	}
 
-	int n = prices.size(); 
-   /* implement your algorithm here */
-	return OPTF(n, OPT, price_map, fee);
+	if (nonNegative && bound <= std::numeric_limits<uint16_t>::max()) {
+		static thread_local std::vector<uint16_t> narrow;
+		if (OPTF(prices, fee, narrow)) {
+			return narrow.back();
+		}
+	}
 
+	static thread_local std::vector<int> wide;
+	OPTF(prices, fee, wide);
+	return wide.back();
 }
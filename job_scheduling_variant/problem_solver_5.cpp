@@ -22,7 +22,10 @@ const char* largeDataset = "large_problem_set_5.in";
 
 const char*  helpMsg = "Please, indicate which problem set to use.\n\n"
                        "For small problem set, type: ./problem_solver_5 small\n"
-                       "For large problem set, type: ./problem_solver_5 large\n";
+                       "For large problem set, type: ./problem_solver_5 large\n"
+                       "To solve each problem as soon as it is read, add --stream\n"
+                       "To solve problems on all cores while reading, add --pipeline\n"
+                       "To set the number of solver threads, add --threads=N\n";
 
 const char* strNotice = "##################################\n"
                         "# Do not edit this file!\n"
@@ -38,6 +41,18 @@ struct ProblemN5: public TestFramework::BasicProblem
    int scale;
 };
 
+struct ProblemN5Schema
+{
+   static constexpr auto Fields()
+   {
+      return std::tuple_cat(TestFramework::DefaultProblemFields<ProblemN5>(), std::make_tuple(
+                TestFramework::MakeField<ProblemN5, std::vector<int>>("x", &ProblemN5::x),
+                TestFramework::MakeField<ProblemN5, std::vector<int>>("y", &ProblemN5::y),
+                TestFramework::MakeField<ProblemN5, int>("maxDistance", &ProblemN5::maxDistance),
+                TestFramework::MakeField<ProblemN5, int>("scale", &ProblemN5::scale)));
+   }
+};
+
 int MaxTour(const std::vector<int>& x,
             const std::vector<int>& y, 
             int maxDistance,
@@ -69,6 +84,10 @@ int main(int argc, char *argv[])
    static_assert (GetTestFrameworkVersion () == 7,
       "TestFramework version 7 is required. Please, update test_framework.h.");
 
+   bool bStream = ExtractFlag(argc, argv, "--stream");
+   bool bPipeline = ExtractFlag(argc, argv, "--pipeline");
+   size_t nThreads = ExtractThreadCount(argc, argv);
+
    ExitIfConditionFails((argc == 2) || (argc == 3), helpMsg);
    std::string firstArg(argv[1]);
 
@@ -82,13 +101,7 @@ int main(int argc, char *argv[])
    AddDefaultProblemSetColumns(psAdapter);
 
    std::vector<ProblemN5> problems;
-   TableAdapter<ProblemN5> prAdapter(problems);
-   AddDefaultProblemColumns(prAdapter);
-
-   AddColumn<ProblemN5>(prAdapter, "x", &ProblemN5::x);
-   AddColumn<ProblemN5>(prAdapter, "y", &ProblemN5::y);
-   AddColumn<ProblemN5>(prAdapter, "maxDistance", &ProblemN5::maxDistance);
-   AddColumn<ProblemN5>(prAdapter, "scale", &ProblemN5::scale);
+   StaticTableAdapter<ProblemN5, ProblemN5Schema> prAdapter(problems);
 
    BasicYamlParser parser(dynamic_cast<ITable*>(&psAdapter),
                           dynamic_cast<ITable*>(&prAdapter));
@@ -96,32 +109,55 @@ int main(int argc, char *argv[])
    const char* inputFilename = bSmallDataset ? smallDataset : largeDataset;
    std::cout << "File: " << inputFilename << ".\n";
 
-   parser.ParseFile(inputFilename, true);
-   GetStudentName(header.student_name);
-   PreprocessProblemSet(problem_set_id, problems, header);
-
-   for (int i = 0; i < (int) problems.size(); ++i)
+   auto solve = [](ProblemN5& theProblem)
    {
-      auto& theProblem = problems[i];
+      theProblem.input_size = (int) theProblem.x.size();
       theProblem.student_answer = MaxTour(theProblem.x,
                                           theProblem.y, 
                                           theProblem.maxDistance,
                                           theProblem.scale);
+   };
+
+   const char* outputFilename = (argc == 3) ? argv[2] : nullptr;
+   TableAdapter<ProblemN5> prOutAdapter(problems);
+   AddDefaultProblemColumnsForOutput(prOutAdapter);
+
+   if (bPipeline)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetPipelined(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice, nThreads);
+   }
+   else if (bStream)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetStreaming(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice);
    }
+   else
+   {
+      parser.ParseFileCached(inputFilename, true);
+      GetStudentName(header.student_name);
+      PreprocessProblemSet(problem_set_id, problems, header);
 
-   ProcessResults(problems, header);
+      std::vector<WorkerStats> workerStats = ParallelSolve(problems, solve, nThreads);
+
+      ProcessResults(problems, header);
+      ReportWorkerStats(workerStats);
+   }
 
    std::cout << "Don't forget to submit your source code on Canvas.";
    std::cout << std::endl << std::endl;
 
-   if (argc == 3)
+   if (outputFilename != nullptr)
    {
-      const char * outputFilename = argv[2];
       std::cout << "Generating a report. ";
       std::cout << "The report is saved in file '" << outputFilename << "'.\n";
-      TableAdapter<ProblemN5> prOutAdapter(problems);
-      AddDefaultProblemColumnsForOutput(prOutAdapter);
 
-      WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      //the streaming modes write the report as they go
+      if (!bStream && !bPipeline)
+      {
+         WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      }
    }
 }
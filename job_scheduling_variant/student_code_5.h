@@ -161,3 +161,92 @@ int MaxTour(const std::vector<Point>& points, double maxDistance)
    }
    return answer;
 }
+
+// Multi-depot variant of MaxTour. Every tour starts and ends at the same depot
+// and visits points in index order, exactly as MaxTour does for the origin.
+//
+// Only the first leg (depot -> first point) and the last leg (last point ->
+// depot) depend on the depot, so the point-to-point distance table is built
+// once and shared. Each DP cell stores one value per depot, laid out
+// contiguously, so the inner relaxation runs over all depots as a batch of
+// independent lanes.
+//
+// Returns the maximum number of points for each depot (same order as depots).
+std::vector<int> MaxTourMultiDepot(const std::vector<Point>& points,
+    const std::vector<Point>& depots, double maxDistance)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const size_t n = points.size();
+    const size_t nDepots = depots.size();
+    std::vector<int> answers(nDepots, 0);
+
+    if (n == 0 || nDepots == 0) {
+        return answers;
+    }
+
+    std::vector<double> distBtwn(n * n, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            double d = manhat(int(i), int(j), points);
+            distBtwn[i * n + j] = d;
+            distBtwn[j * n + i] = d;
+        }
+    }
+
+    // depotDist[j * nDepots + d] is the distance between point j and depot d
+    std::vector<double> depotDist(n * nDepots);
+    for (size_t j = 0; j < n; j++) {
+        for (size_t d = 0; d < nDepots; d++) {
+            depotDist[j * nDepots + d] = sqrt(pow((points[j].x - depots[d].x), 2) +
+                pow((points[j].y - depots[d].y), 2) * 1.0);
+        }
+    }
+
+    // tail[j * nDepots + d] is the shortest path that starts at point j,
+    // visits i more points in index order and returns to depot d.
+    // Layer i = 0 is just the way back to the depot.
+    std::vector<double> tail(depotDist);
+    std::vector<double> nextTail(n * nDepots);
+
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) {
+            for (size_t j = 0; j < n; j++) {
+                double* out = &nextTail[j * nDepots];
+                for (size_t d = 0; d < nDepots; d++) {
+                    out[d] = inf;
+                }
+                for (size_t k = j + 1; k < n; k++) {
+                    const double w = distBtwn[j * n + k];
+                    const double* in = &tail[k * nDepots];
+                    for (size_t d = 0; d < nDepots; d++) {
+                        double candidate = w + in[d];
+                        out[d] = candidate < out[d] ? candidate : out[d];
+                    }
+                }
+            }
+            tail.swap(nextTail);
+        }
+
+        // close the tour with the depot-dependent first leg
+        bool anyFeasible = false;
+        for (size_t j = 0; j < n; j++) {
+            for (size_t d = 0; d < nDepots; d++) {
+                double tour = depotDist[j * nDepots + d] + tail[j * nDepots + d];
+                if (tour <= maxDistance) {
+                    anyFeasible = true;
+                    if (int(i) + 1 > answers[d]) {
+                        answers[d] = int(i) + 1;
+                    }
+                }
+            }
+        }
+
+        // By the triangle inequality, a tour through more points is never
+        // shorter, so once no depot can afford i + 1 points we are done.
+        if (!anyFeasible) {
+            break;
+        }
+    }
+
+    return answers;
+}
@@ -12,6 +12,7 @@
 //    cl problem_solver_6.cpp /EHsc /O2
 //
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include "test_framework.h"
@@ -22,7 +23,10 @@ const char* largeDataset = "large_problem_set_6.in";
 
 const char*  helpMsg = "Please, indicate which problem set to use.\n\n"
                        "For small problem set, type: ./problem_solver_6 small\n"
-                       "For large problem set, type: ./problem_solver_6 large\n";
+                       "For large problem set, type: ./problem_solver_6 large\n"
+                       "To solve each problem as soon as it is read, add --stream\n"
+                       "To solve problems on all cores while reading, add --pipeline\n"
+                       "To set the number of solver threads, add --threads=N\n";
 
 const char* strNotice = "##################################\n"
                         "# Do not edit this file!\n"
@@ -35,56 +39,65 @@ struct ProblemN6: public TestFramework::BasicProblem
    std::vector<int> processing_times;
    std::vector<int> energy_consumption;
    int maxEnergy;
+   int nCores;
 };
 
+struct ProblemN6Schema
+{
+   static constexpr auto Fields()
+   {
+      return std::tuple_cat(TestFramework::DefaultProblemFields<ProblemN6>(), std::make_tuple(
+                TestFramework::MakeField<ProblemN6, std::vector<int>>("processing_times", &ProblemN6::processing_times),
+                TestFramework::MakeField<ProblemN6, std::vector<int>>("energy_consumption", &ProblemN6::energy_consumption),
+                TestFramework::MakeField<ProblemN6, int>("maxEnergy", &ProblemN6::maxEnergy),
+                TestFramework::MakeField<ProblemN6, int>("cores", &ProblemN6::nCores, 8)));
+   }
+};
 
-template<typename T>
-auto create_table(int size, T value)
-{   
-   std::vector<T> table(size, value);
-   return table;
-}
-
-template<typename... Targs>
-auto create_table(int size, Targs... args)
-{ 
-   auto slice = create_table(args...);
-   std::vector<decltype(slice)> table(size, slice);
-   return table;
-}
 
 int MinProcessingTime(const std::vector<int>& processing_times,
                       const std::vector<int>& energy_consumption,
-                      int maxEnergy)
+                      int maxEnergy,
+                      int nCores,
+                      MptPruneStats* stats)
 {
-   int nCores = 8;
    const char* msgCorruptedData = "Corrupted data set.";
 
    TestFramework::ExitIfConditionFails(
+         (nCores > 0) &&
          (processing_times.size() == energy_consumption.size()) && 
          (processing_times.size() % nCores == 0),
          msgCorruptedData);
 
    int nJobs = processing_times.size() / nCores;
 
-   auto jobProfiles = create_table(nJobs, nCores, Profile());
+   MptProfileTable jobProfiles(nJobs, nCores);
 
    for (int i = 0; i < nJobs; ++i)
    {
       for (int j = 0; j < nCores; ++j)
       {
          int index = i * nCores + j;
-         jobProfiles[i][j].time   = processing_times[index];
-         jobProfiles[i][j].energy = energy_consumption[index];
+         Profile& profile = jobProfiles.At(i, j);
+         profile.time   = processing_times[index];
+         profile.energy = energy_consumption[index];
 
-         bool isPositive = (jobProfiles[i][j].time >= 0) && 
-                           (jobProfiles[i][j].energy >= 0);
+         bool isPositive = (profile.time >= 0) && 
+                           (profile.energy >= 0);
          
          TestFramework::ExitIfConditionFails(isPositive, msgCorruptedData);
       }
    }
 
-   return MinProcessingTime(jobProfiles, maxEnergy);
+   return MinProcessingTime(jobProfiles, maxEnergy, stats);
+}
+
+void ReportPruneStats(const MptPruneStats& stats)
+{
+   std::cout << "Pruning: " << stats.kept << " of " << stats.profiles << " profile(s) kept ("
+             << stats.dominated << " dominated, " << stats.duplicateEnergy << " duplicate energy, "
+             << stats.overBudget << " over budget); " << stats.distinctJobs << " distinct of "
+             << stats.jobs << " job(s)." << std::endl;
 }
 
 int main(int argc, char *argv[])
@@ -94,6 +107,10 @@ int main(int argc, char *argv[])
    static_assert (GetTestFrameworkVersion () == 7,
       "TestFramework version 7 is required. Please, update test_framework.h.");
 
+   bool bStream = ExtractFlag(argc, argv, "--stream");
+   bool bPipeline = ExtractFlag(argc, argv, "--pipeline");
+   size_t nThreads = ExtractThreadCount(argc, argv);
+
    ExitIfConditionFails((argc == 2) || (argc == 3), helpMsg);
    std::string firstArg(argv[1]);
 
@@ -107,12 +124,7 @@ int main(int argc, char *argv[])
    AddDefaultProblemSetColumns(psAdapter);
 
    std::vector<ProblemN6> problems;
-   TableAdapter<ProblemN6> prAdapter(problems);
-   AddDefaultProblemColumns(prAdapter);
-
-   AddColumn<ProblemN6>(prAdapter, "processing_times", &ProblemN6::processing_times);
-   AddColumn<ProblemN6>(prAdapter, "energy_consumption", &ProblemN6::energy_consumption);
-   AddColumn<ProblemN6>(prAdapter, "maxEnergy", &ProblemN6::maxEnergy);
+   StaticTableAdapter<ProblemN6, ProblemN6Schema> prAdapter(problems);
 
    BasicYamlParser parser(dynamic_cast<ITable*>(&psAdapter),
                           dynamic_cast<ITable*>(&prAdapter));
@@ -120,30 +132,61 @@ int main(int argc, char *argv[])
    const char* inputFilename = bSmallDataset ? smallDataset : largeDataset;
    std::cout << "File: " << inputFilename << ".\n";
 
-   parser.ParseFile(inputFilename, true);
-   GetStudentName(header.student_name);
-   PreprocessProblemSet(problem_set_id, problems, header);
+   MptPruneStats pruneStats;
+   std::mutex pruneStatsMutex;
 
-   for (int i = 0; i < (int) problems.size(); ++i)
+   auto solve = [&](ProblemN6& theProblem)
    {
-      auto& theProblem = problems[i];
-      theProblem.student_answer = MinProcessingTime(theProblem.processing_times, theProblem.energy_consumption, theProblem.maxEnergy);
+      MptPruneStats stats;
+      theProblem.input_size = (int) theProblem.processing_times.size();
+      theProblem.student_answer = MinProcessingTime(theProblem.processing_times, theProblem.energy_consumption, theProblem.maxEnergy, theProblem.nCores, &stats);
+
+      std::lock_guard<std::mutex> lock(pruneStatsMutex);
+      pruneStats += stats;
+   };
+
+   const char* outputFilename = (argc == 3) ? argv[2] : nullptr;
+   TableAdapter<ProblemN6> prOutAdapter(problems);
+   AddDefaultProblemColumnsForOutput(prOutAdapter);
+
+   if (bPipeline)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetPipelined(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice, nThreads);
+   }
+   else if (bStream)
+   {
+      GetStudentName(header.student_name);
+      SolveProblemSetStreaming(problem_set_id, inputFilename, parser, header, problems, solve,
+                               &psAdapter, &prOutAdapter, outputFilename, strNotice);
    }
+   else
+   {
+      parser.ParseFileCached(inputFilename, true);
+      GetStudentName(header.student_name);
+      PreprocessProblemSet(problem_set_id, problems, header);
+
+      std::vector<WorkerStats> workerStats = ParallelSolve(problems, solve, nThreads);
 
-   ProcessResults(problems, header);
+      ProcessResults(problems, header);
+      ReportWorkerStats(workerStats);
+   }
 
+   ReportPruneStats(pruneStats);
    std::cout << "Don't forget to submit your source code on Canvas.";
    std::cout << std::endl << std::endl;
 
-   if (argc == 3)
+   if (outputFilename != nullptr)
    {
-      const char * outputFilename = argv[2];
       std::cout << "Generating a report. ";
       std::cout << "The report is saved in file '" << outputFilename << "'.\n";
-      TableAdapter<ProblemN6> prOutAdapter(problems);
-      AddDefaultProblemColumnsForOutput(prOutAdapter);
 
-      WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      //the streaming modes write the report as they go
+      if (!bStream && !bPipeline)
+      {
+         WriteTableToFile(outputFilename, &prOutAdapter, &psAdapter, true, strNotice);
+      }
    }
 
    return 0;
@@ -17,8 +17,17 @@
 #include <vector>
 #include <algorithm>
 #include <limits>
-#include <queue>
 #include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 //you can include standard C++ libraries here
 
@@ -38,53 +47,2778 @@ struct Profile
    int energy {0};
 };
 
-int mptRecHelper(const std::vector<std::vector<Profile>> p, int mE, int i, /* std::vector<std::vector<int>>*/ int** OPT) {
-    int overflow_separator = 100000000;
-    int inf_num = std::numeric_limits<int>::max() - overflow_separator;
-    if (i == 0) {
-        return 0;
+// Value used for energy budgets that cannot run all jobs
+const int mptInfinity = std::numeric_limits<int>::max() - 100000000;
+
+// Which dimension the dense DP is indexed by
+enum class MptFormulation
+{
+    Auto,      // whichever table is smaller
+    Energy,    // minimum time for every energy budget
+    Time       // minimum energy for every time limit
+};
+
+// Tunables of the MinProcessingTime engines
+struct MptConfig
+{
+    MptFormulation formulation = MptFormulation::Auto;
+
+    // Largest working set of the dense engine (both rows, in bytes). Bigger
+    // instances run on the sparse Pareto-list engine instead.
+    size_t denseMemoryBudget = size_t(8) << 20;
+
+    // Threads of the energy-tiled stage executor (0: one per hardware
+    // thread, 1: off). Read when the pool is first used.
+    int stageThreads = 0;
+
+    // Energy levels per tile. A tile of both rows (128 KB by default) stays
+    // resident in L2; rows narrower than two tiles are not split. Tiles are
+    // rounded down to whole cache lines (at least one); 0 or less turns
+    // tiling off.
+    int stageTileCells = 16384;
+
+    // Run the dense engines on 16-bit cells when every finite cell of the
+    // instance is known to fit
+    bool narrowCells = true;
+
+    // Bands of at least this many cells get a reachability pass over the
+    // energy sums; if fewer than sparseDensity of the cells are reachable,
+    // the instance runs on the sparse engine, whose lists only hold
+    // reachable sums. 0 disables the pass.
+    int reachabilityMinCells = 1 << 16;
+    double sparseDensity = 1.0 / 32;
+};
+
+MptConfig& mptConfig()
+{
+    static MptConfig config;
+    return config;
+}
+
+// Cell types of the dense rows. int cells hold any value below mptInfinity;
+// uint16_t cells are used when an upper bound of the instance is below
+// 0xFFFF and saturate at that value, so an overflow shows up as an
+// infinite cell and the solve is redone with int cells.
+template<class Cell>
+struct MptCell;
+
+template<>
+struct MptCell<int>
+{
+    static int Infinity() { return mptInfinity; }
+};
+
+template<>
+struct MptCell<uint16_t>
+{
+    static uint16_t Infinity() { return 0xFFFF; }
+};
+
+// Two rolling rows of the DP table. Row e holds the minimum total time of
+// the jobs processed so far when at most e units of energy are used.
+// The rows are kept between calls so that repeated solves do not allocate.
+template<class Cell = int>
+struct MptRows
+{
+    std::vector<Cell> cur;
+    std::vector<Cell> next;
+
+    void Reset(int maxEnergy)
+    {
+        cur.assign(size_t(maxEnergy) + 1, 0);
+        next.resize(size_t(maxEnergy) + 1);
+    }
+};
+
+// Saturating add for the DP cells: the result never exceeds mptInfinity,
+// so infeasible cells stay infeasible without an explicit overflow guard.
+// Requires 0 <= value and 0 <= time <= mptInfinity.
+inline int mptSaturatingAdd(int value, int time)
+{
+    const int cap = mptInfinity - time;
+    return (value < cap ? value : cap) + time;
+}
+
+// Portable version of the stage transition, for cells first..last:
+//    next[e] = min over cores k of cur[e - energy_k] + time_k
+//
+// All kernels are templated on the number of profiles in the stage. A
+// positive NCores fixes the trip count of the core loop so the compiler can
+// unroll it completely; NCores = 0 is the generic path that reads nCores.
+template<int NCores>
+void mptTransitionScalar(const int* cur, int* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    std::fill(next + first, next + last + 1, mptInfinity);
+    for (int k = 0; k < n; k++) {
+        const int energy = job[k].energy;
+        const int time = job[k].time;
+        for (int e = (energy > first ? energy : first); e <= last; e++) {
+            int candidate = mptSaturatingAdd(cur[e - energy], time);
+            next[e] = candidate < next[e] ? candidate : next[e];
+        }
+    }
+}
+
+// Single cell of the transition, used for the ragged edges of the SSE kernel
+inline int mptTransitionCell(const int* cur, int e, const Profile* job, int nCores)
+{
+    int best = mptInfinity;
+    for (int k = 0; k < nCores; k++) {
+        if (e >= job[k].energy) {
+            int candidate = mptSaturatingAdd(cur[e - job[k].energy], job[k].time);
+            best = candidate < best ? candidate : best;
+        }
+    }
+    return best;
+}
+
+// 16-bit counterparts. Times above 0xFFFF are clamped to it: such a profile
+// can never be part of a schedule whose total fits in a narrow cell.
+inline uint16_t mptNarrowTime(int time)
+{
+    return uint16_t(time < 0xFFFF ? time : 0xFFFF);
+}
+
+inline uint16_t mptSaturatingAdd(uint16_t value, uint16_t time)
+{
+    const unsigned sum = unsigned(value) + time;
+    return uint16_t(sum < 0xFFFF ? sum : 0xFFFF);
+}
+
+template<int NCores>
+void mptTransitionScalar(const uint16_t* cur, uint16_t* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    std::fill(next + first, next + last + 1, MptCell<uint16_t>::Infinity());
+    for (int k = 0; k < n; k++) {
+        const int energy = job[k].energy;
+        const uint16_t time = mptNarrowTime(job[k].time);
+        for (int e = (energy > first ? energy : first); e <= last; e++) {
+            uint16_t candidate = mptSaturatingAdd(cur[e - energy], time);
+            next[e] = candidate < next[e] ? candidate : next[e];
+        }
+    }
+}
+
+inline uint16_t mptTransitionCell(const uint16_t* cur, int e, const Profile* job, int nCores)
+{
+    uint16_t best = MptCell<uint16_t>::Infinity();
+    for (int k = 0; k < nCores; k++) {
+        if (e >= job[k].energy) {
+            uint16_t candidate = mptSaturatingAdd(cur[e - job[k].energy], mptNarrowTime(job[k].time));
+            best = candidate < best ? candidate : best;
+        }
+    }
+    return best;
+}
+
+// The vector kernels below process a block of consecutive energy levels at a
+// time. For each core they load the block of cur shifted by the core's energy
+// (an unaligned load), add the time with saturation and fold it into a
+// running vertical minimum, so every cell of next is written exactly once.
+// Lanes past the last cell are masked off. No load address ever points
+// before the row: AVX-512 masks off the lanes below a core's energy, and
+// the other kernels redo the blocks that straddle it per cell.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MPT_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MPT_TARGET(arch)
+#else
+#define MPT_TARGET(arch) __attribute__((target(arch)))
+#endif
+
+template<int NCores>
+MPT_TARGET("sse4.1")
+void mptTransitionSse41(const int* cur, int* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m128i inf = _mm_set1_epi32(mptInfinity);
+
+    int minEnergy = mptInfinity;
+    for (int k = 0; k < n; k++) {
+        minEnergy = job[k].energy < minEnergy ? job[k].energy : minEnergy;
+    }
+
+    int e0 = first;
+    for (; e0 + 4 <= nCells; e0 += 4) {
+        if (e0 + 3 < minEnergy) {
+            _mm_storeu_si128((__m128i*)(next + e0), inf);
+            continue;
+        }
+        __m128i best = inf;
+        bool ragged = false;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 3 < energy) continue;
+            if (e0 < energy) {
+                ragged = true;
+                continue;
+            }
+            __m128i v = _mm_loadu_si128((const __m128i*)(cur + e0 - energy));
+            v = _mm_min_epi32(v, _mm_set1_epi32(mptInfinity - job[k].time));
+            v = _mm_add_epi32(v, _mm_set1_epi32(job[k].time));
+            best = _mm_min_epi32(best, v);
+        }
+        _mm_storeu_si128((__m128i*)(next + e0), best);
+        if (ragged) {
+            // SSE has no masked loads, so redo the few partial blocks per cell
+            for (int e = e0; e < e0 + 4; e++) {
+                next[e] = mptTransitionCell(cur, e, job, n);
+            }
+        }
+    }
+    for (int e = e0; e < nCells; e++) {
+        next[e] = mptTransitionCell(cur, e, job, n);
+    }
+}
+
+template<int NCores>
+MPT_TARGET("avx2")
+void mptTransitionAvx2(const int* cur, int* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m256i inf = _mm256_set1_epi32(mptInfinity);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i cellLimit = _mm256_set1_epi32(nCells);
+
+    for (int e0 = first; e0 < nCells; e0 += 8) {
+        const bool fullBlock = (e0 + 8 <= nCells);
+        const __m256i cells = _mm256_add_epi32(_mm256_set1_epi32(e0), lanes);
+        const __m256i inRange = _mm256_cmpgt_epi32(cellLimit, cells);
+
+        __m256i best = inf;
+        bool ragged = false;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 7 < energy) continue;
+            if (e0 < energy) {
+                // cur + (e0 - energy) would point before the row, so blocks
+                // that straddle the energy are redone per cell
+                ragged = true;
+                continue;
+            }
+
+            __m256i v;
+            if (fullBlock) {
+                v = _mm256_loadu_si256((const __m256i*)(cur + e0 - energy));
+            }
+            else {
+                // the tail: valid lanes satisfy e < nCells
+                v = _mm256_maskload_epi32(cur + (e0 - energy), inRange);
+                v = _mm256_blendv_epi8(inf, v, inRange);
+            }
+            v = _mm256_min_epi32(v, _mm256_set1_epi32(mptInfinity - job[k].time));
+            v = _mm256_add_epi32(v, _mm256_set1_epi32(job[k].time));
+            best = _mm256_min_epi32(best, v);
+        }
+
+        if (fullBlock) {
+            _mm256_storeu_si256((__m256i*)(next + e0), best);
+        }
+        else {
+            _mm256_maskstore_epi32(next + e0, inRange, best);
+        }
+        if (ragged) {
+            const int blockEnd = fullBlock ? e0 + 8 : nCells;
+            for (int e = e0; e < blockEnd; e++) {
+                next[e] = mptTransitionCell(cur, e, job, n);
+            }
+        }
+    }
+}
+
+template<int NCores>
+MPT_TARGET("avx512f")
+void mptTransitionAvx512(const int* cur, int* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m512i inf = _mm512_set1_epi32(mptInfinity);
+
+    for (int e0 = first; e0 < nCells; e0 += 16) {
+        const int blockSize = (nCells - e0 < 16) ? (nCells - e0) : 16;
+        const __mmask16 inRange = (__mmask16)((1u << blockSize) - 1);
+
+        __m512i best = inf;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 15 < energy) continue;
+
+            __m512i v;
+            if (blockSize == 16 && e0 >= energy) {
+                v = _mm512_loadu_si512((const void*)(cur + e0 - energy));
+            }
+            else {
+                // valid lanes satisfy energy <= e < nCells; the expanding
+                // load reads them from cur[e0 + skip - energy] on, so the
+                // address never points before the row
+                int skip = (energy > e0) ? (energy - e0) : 0;
+                __mmask16 mask = (__mmask16)(inRange & ~((1u << skip) - 1));
+                v = _mm512_mask_expandloadu_epi32(inf, mask, cur + (e0 + skip - energy));
+            }
+            // the masked forms with a full mask: the plain ones pass an
+            // undefined source that g++ 12 reports as maybe-uninitialized
+            v = _mm512_maskz_min_epi32(0xFFFF, v, _mm512_set1_epi32(mptInfinity - job[k].time));
+            v = _mm512_add_epi32(v, _mm512_set1_epi32(job[k].time));
+            best = _mm512_maskz_min_epi32(0xFFFF, best, v);
+        }
+
+        _mm512_mask_storeu_epi32(next + e0, inRange, best);
+    }
+}
+
+// 16-bit kernels: twice the cells per vector, with unsigned saturating adds
+// (infinity is 0xFFFF) in place of the clamp-then-add of the int kernels.
+// Without 16-bit masked loads before AVX-512BW, blocks that straddle a
+// core's energy are redone per cell as in the SSE int kernel.
+template<int NCores>
+MPT_TARGET("sse4.1")
+void mptTransitionSse41(const uint16_t* cur, uint16_t* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m128i inf = _mm_set1_epi16(-1);
+
+    int e0 = first;
+    for (; e0 + 8 <= nCells; e0 += 8) {
+        __m128i best = inf;
+        bool ragged = false;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 7 < energy) continue;
+            if (e0 < energy) {
+                ragged = true;
+                continue;
+            }
+            __m128i v = _mm_loadu_si128((const __m128i*)(cur + e0 - energy));
+            v = _mm_adds_epu16(v, _mm_set1_epi16(short(mptNarrowTime(job[k].time))));
+            best = _mm_min_epu16(best, v);
+        }
+        _mm_storeu_si128((__m128i*)(next + e0), best);
+        if (ragged) {
+            for (int e = e0; e < e0 + 8; e++) {
+                next[e] = mptTransitionCell(cur, e, job, n);
+            }
+        }
+    }
+    for (int e = e0; e < nCells; e++) {
+        next[e] = mptTransitionCell(cur, e, job, n);
+    }
+}
+
+template<int NCores>
+MPT_TARGET("avx2")
+void mptTransitionAvx2(const uint16_t* cur, uint16_t* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m256i inf = _mm256_set1_epi16(-1);
+
+    int e0 = first;
+    for (; e0 + 16 <= nCells; e0 += 16) {
+        __m256i best = inf;
+        bool ragged = false;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 15 < energy) continue;
+            if (e0 < energy) {
+                ragged = true;
+                continue;
+            }
+            __m256i v = _mm256_loadu_si256((const __m256i*)(cur + e0 - energy));
+            v = _mm256_adds_epu16(v, _mm256_set1_epi16(short(mptNarrowTime(job[k].time))));
+            best = _mm256_min_epu16(best, v);
+        }
+        _mm256_storeu_si256((__m256i*)(next + e0), best);
+        if (ragged) {
+            for (int e = e0; e < e0 + 16; e++) {
+                next[e] = mptTransitionCell(cur, e, job, n);
+            }
+        }
+    }
+    for (int e = e0; e < nCells; e++) {
+        next[e] = mptTransitionCell(cur, e, job, n);
+    }
+}
+
+template<int NCores>
+MPT_TARGET("avx512f,avx512bw")
+void mptTransitionAvx512(const uint16_t* cur, uint16_t* next, int first, int last,
+    const Profile* job, int nCores)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    const int nCells = last + 1;
+    const __m512i inf = _mm512_set1_epi16(-1);
+
+    for (int e0 = first; e0 < nCells; e0 += 32) {
+        const int blockSize = (nCells - e0 < 32) ? (nCells - e0) : 32;
+        const __mmask32 inRange = (blockSize == 32) ? ~__mmask32(0) :
+            __mmask32((1u << blockSize) - 1);
+
+        __m512i best = inf;
+        for (int k = 0; k < n; k++) {
+            const int energy = job[k].energy;
+            if (e0 + 31 < energy) continue;
+
+            __m512i v;
+            if (blockSize == 32 && e0 >= energy) {
+                v = _mm512_loadu_si512((const void*)(cur + e0 - energy));
+            }
+            else {
+                // valid lanes satisfy energy <= e < nCells; there is no
+                // 16-bit expanding load before VBMI2, so load them from
+                // cur[e0 + skip - energy] into the low lanes and move them
+                // up by skip lanes
+                int skip = (energy > e0) ? (energy - e0) : 0;
+                __mmask32 mask = inRange & ~__mmask32((1ull << skip) - 1);
+                v = _mm512_maskz_loadu_epi16(mask >> skip, cur + (e0 + skip - energy));
+                if (skip > 0) {
+                    const __m512i lanes = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24,
+                        23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8,
+                        7, 6, 5, 4, 3, 2, 1, 0);
+                    v = _mm512_permutexvar_epi16(_mm512_sub_epi16(lanes, _mm512_set1_epi16(short(skip))), v);
+                }
+                v = _mm512_mask_mov_epi16(inf, mask, v);
+            }
+            v = _mm512_adds_epu16(v, _mm512_set1_epi16(short(mptNarrowTime(job[k].time))));
+            best = _mm512_min_epu16(best, v);
+        }
+
+        _mm512_mask_storeu_epi16(next + e0, inRange, best);
+    }
+}
+#endif
+
+enum class MptSimdLevel { Scalar, Sse41, Avx2, Avx512, Avx512Bw };
+
+// Widest instruction set supported by both the CPU and the OS
+MptSimdLevel mptDetectSimdLevel()
+{
+#if defined(MPT_X86_KERNELS)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] >> 19) & 1;
+    const bool osxsave = (info[2] >> 27) & 1;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false;
+    bool avx512 = false;
+    bool avx512bw = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = ((info[1] >> 5) & 1) && ((xcr0 & 0x6) == 0x6);
+        avx512 = ((info[1] >> 16) & 1) && ((xcr0 & 0xe6) == 0xe6);
+        avx512bw = avx512 && ((info[1] >> 30) & 1);
+    }
+    if (avx512bw) return MptSimdLevel::Avx512Bw;
+    if (avx512) return MptSimdLevel::Avx512;
+    if (avx2) return MptSimdLevel::Avx2;
+    if (sse41) return MptSimdLevel::Sse41;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return MptSimdLevel::Avx512Bw;
+    }
+    if (__builtin_cpu_supports("avx512f")) return MptSimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return MptSimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return MptSimdLevel::Sse41;
+#endif
+#endif
+    return MptSimdLevel::Scalar;
+}
+
+typedef void (*MptTransitionKernel)(const int*, int*, int, int, const Profile*, int);
+typedef void (*MptNarrowKernel)(const uint16_t*, uint16_t*, int, int, const Profile*, int);
+
+// Kernel of each instruction set, by cell type
+template<class Cell>
+struct MptKernels;
+
+template<>
+struct MptKernels<int>
+{
+    typedef MptTransitionKernel Kernel;
+
+    template<int NCores>
+    static Kernel For(MptSimdLevel level)
+    {
+#if defined(MPT_X86_KERNELS)
+        switch (level) {
+        case MptSimdLevel::Avx512Bw:
+        case MptSimdLevel::Avx512: return mptTransitionAvx512<NCores>;
+        case MptSimdLevel::Avx2: return mptTransitionAvx2<NCores>;
+        case MptSimdLevel::Sse41: return mptTransitionSse41<NCores>;
+        default: break;
+        }
+#endif
+        return mptTransitionScalar<NCores>;
+    }
+};
+
+template<>
+struct MptKernels<uint16_t>
+{
+    typedef MptNarrowKernel Kernel;
+
+    template<int NCores>
+    static Kernel For(MptSimdLevel level)
+    {
+#if defined(MPT_X86_KERNELS)
+        switch (level) {
+        case MptSimdLevel::Avx512Bw: return mptTransitionAvx512<NCores>;
+        case MptSimdLevel::Avx512:
+        case MptSimdLevel::Avx2: return mptTransitionAvx2<NCores>;
+        case MptSimdLevel::Sse41: return mptTransitionSse41<NCores>;
+        default: break;
+        }
+#endif
+        return mptTransitionScalar<NCores>;
+    }
+};
+
+// Stages with up to 8 profiles (all pruned frontiers of the 8-core problem
+// sets) and 16 profiles get an unrolled kernel, larger ones the generic one
+template<class Cell = int>
+typename MptKernels<Cell>::Kernel mptSelectKernel(MptSimdLevel level, int nCores)
+{
+    typedef MptKernels<Cell> Kernels;
+    switch (nCores) {
+    case 1: return Kernels::template For<1>(level);
+    case 2: return Kernels::template For<2>(level);
+    case 3: return Kernels::template For<3>(level);
+    case 4: return Kernels::template For<4>(level);
+    case 5: return Kernels::template For<5>(level);
+    case 6: return Kernels::template For<6>(level);
+    case 7: return Kernels::template For<7>(level);
+    case 8: return Kernels::template For<8>(level);
+    case 16: return Kernels::template For<16>(level);
+    default: return Kernels::template For<0>(level);
+    }
+}
+
+// Computes cells first..last of the next row with the best kernel for this
+// machine. The instruction set is detected once, on first use.
+template<class Cell>
+void mptTransitionRange(const Cell* cur, Cell* next, int first, int last,
+    const std::vector<Profile>& job)
+{
+    static const MptSimdLevel level = mptDetectSimdLevel();
+    const int nCores = int(job.size());
+    mptSelectKernel<Cell>(level, nCores)(cur, next, first, last, job.data(), nCores);
+}
+
+// Advances the DP by one job
+template<class Cell>
+void mptTransition(const Cell* cur, Cell* next, int maxEnergy,
+    const std::vector<Profile>& job)
+{
+    mptTransitionRange(cur, next, 0, maxEnergy, job);
+}
+
+// Persistent pool that runs one stage at a time, split over the energy
+// range. next[e] only depends on cur, so the row is cut into tiles that are
+// dealt out round-robin; the calling thread works too, and the stage ends
+// with a single barrier. Tile boundaries are aligned to 64-byte cache lines
+// of next, so no two threads ever write to the same line.
+class MptStagePool
+{
+public:
+    explicit MptStagePool(int nThreads) : nThreads(nThreads < 1 ? 1 : nThreads)
+    {
+        for (int id = 1; id < this->nThreads; id++) {
+            workers.emplace_back([this, id]() { WorkerLoop(id); });
+        }
+    }
+
+    ~MptStagePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    int ThreadCount() const { return nThreads; }
+
+    // The pool serves one solve at a time; other threads run sequentially
+    bool TryAcquire() { return owner.try_lock(); }
+    void Release() { owner.unlock(); }
+
+    template<class Cell>
+    void RunStage(const Cell* cur, Cell* next, int bandEnergy,
+        const std::vector<Profile>& job, int tileCells)
+    {
+        const int alignCells = 64 / int(sizeof(Cell));
+        const int skew = int((alignCells - (uintptr_t(next) / sizeof(Cell)) % alignCells) % alignCells);
+        // whole cache lines, at least one
+        const int alignedTile = std::max(alignCells, tileCells - tileCells % alignCells);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stage = Stage{ cur, next, &TileRange<Cell>, bandEnergy, &job, alignedTile, skew };
+            pending = nThreads - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        RunTiles(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+    }
+
+private:
+    typedef void (*TileFunction)(const void*, void*, int, int, const std::vector<Profile>&);
+
+    template<class Cell>
+    static void TileRange(const void* cur, void* next, int first, int last,
+        const std::vector<Profile>& job)
+    {
+        mptTransitionRange(static_cast<const Cell*>(cur), static_cast<Cell*>(next), first, last, job);
+    }
+
+    struct Stage
+    {
+        const void* cur;
+        void* next;
+        TileFunction range;     // transition of the stage's cell type
+        int bandEnergy;
+        const std::vector<Profile>* job;
+        int tileCells;
+        int skew;     // cells before the first cache-line boundary of next
+    };
+
+    void RunTiles(int id)
+    {
+        const Stage& st = stage;
+        const int firstBoundary = st.skew + st.tileCells;
+        const int nTiles = (st.bandEnergy + 1 <= firstBoundary) ? 1 :
+            2 + (st.bandEnergy - firstBoundary) / st.tileCells;
+        for (int t = id; t < nTiles; t += nThreads) {
+            const int first = (t == 0) ? 0 : firstBoundary + (t - 1) * st.tileCells;
+            const int last = std::min(st.bandEnergy, firstBoundary + t * st.tileCells - 1);
+            st.range(st.cur, st.next, first, last, *st.job);
+        }
+    }
+
+    void WorkerLoop(int id)
+    {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            RunTiles(id);
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                last = (--pending == 0);
+            }
+            if (last) {
+                done.notify_one();
+            }
+        }
+    }
+
+private:
+    const int nThreads;
+    std::vector<std::thread> workers;
+    std::mutex owner;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long long generation {0};
+    int pending {0};
+    bool stop {false};
+    Stage stage {};
+};
+
+MptStagePool& mptStagePool()
+{
+    static MptStagePool pool(mptConfig().stageThreads > 0 ? mptConfig().stageThreads :
+        int(std::thread::hardware_concurrency()));
+    return pool;
+}
+
+// Profiles of all jobs in one flat array with a stride of nCores:
+// job i uses entries [i * nCores, (i + 1) * nCores).
+struct MptProfileTable
+{
+    int nJobs {0};
+    int nCores {0};
+    std::vector<Profile> profiles;
+
+    MptProfileTable(int nJobs, int nCores) :
+        nJobs(nJobs), nCores(nCores), profiles(size_t(nJobs) * size_t(nCores)) {}
+
+    Profile& At(int job, int core) { return profiles[size_t(job) * nCores + core]; }
+    const Profile* Job(int job) const { return profiles.data() + size_t(job) * nCores; }
+};
+
+// How much work the preprocessing stage removed from one solve
+struct MptPruneStats
+{
+    int jobs {0};
+    int distinctJobs {0};      // jobs left after merging identical frontiers
+    int profiles {0};          // profiles in the input
+    int dominated {0};         // slower and at least as energy-hungry as another
+    int duplicateEnergy {0};   // same energy as a faster profile
+    int overBudget {0};        // cannot fit next to the other jobs' cheapest cores
+    int kept {0};
+
+    MptPruneStats& operator+=(const MptPruneStats& other)
+    {
+        jobs += other.jobs;
+        distinctJobs += other.distinctJobs;
+        profiles += other.profiles;
+        dominated += other.dominated;
+        duplicateEnergy += other.duplicateEnergy;
+        overBudget += other.overBudget;
+        kept += other.kept;
+        return *this;
+    }
+};
+
+// Jobs sharing the same Pareto frontier, processed as `count` stages.
+// Stage c of the group is job jobs[c] of the input.
+struct MptJobGroup
+{
+    std::vector<Profile> frontier;
+    int count {0};
+    std::vector<int> jobs;
+};
+
+// Preprocessed instance.
+//
+// Every job needs at least the energy of its cheapest profile, so the energy
+// spent on the first i jobs is at least lowEnergy_i (the sum of their minimum
+// energies) and must leave at least the minimum energy of the remaining jobs
+// within maxEnergy. That band has the same width for every stage,
+// maxEnergy - (sum of all minimum energies) + 1, so the DP rows are stored
+// relative to lowEnergy_i and frontier energies are stored relative to the
+// job's cheapest profile. The last cell of the final row is the answer.
+// Band energies are divided by the GCD of all frontier energies, so band
+// cell x stands for lowEnergy + x * energyScale units.
+struct MptPlan
+{
+    std::vector<MptJobGroup> groups;
+    int lowEnergy {0};         // sum of the minimum energies of all jobs
+    int bandEnergy {0};        // last cell of a band row
+    int energyScale {1};       // band and frontier energies are in these units
+    bool sparseEnergies {false};   // few energy sums are reachable
+    bool feasible {true};
+    MptPruneStats stats;
+
+    // Entry f of job i's frontier is core coreOf[coreOffset[i] + f]
+    std::vector<int> coreOffset;
+    std::vector<int> coreOf;
+};
+
+int mptGcd(int a, int b)
+{
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// dst |= src << shift, over a bitset of nWords words
+void mptShiftOr(const uint64_t* src, uint64_t* dst, int nWords, int shift)
+{
+    const int words = shift / 64;
+    const int bits = shift % 64;
+    for (int w = nWords - 1; w >= words; w--) {
+        uint64_t v = src[w - words] << bits;
+        if (bits != 0 && w - words > 0) {
+            v |= src[w - words - 1] >> (64 - bits);
+        }
+        dst[w] |= v;
+    }
+}
+
+bool mptFitsDenseBudget(long long lastCell)
+{
+    const double denseBytes = 2.0 * (double(lastCell) + 1) * sizeof(int);
+    return denseBytes <= double(mptConfig().denseMemoryBudget);
+}
+
+// Shrinks the energy axis of a built plan.
+//
+// Every schedule's energy above lowEnergy is a sum of frontier energies, so
+// when they share a divisor g, only multiples of g are reachable and the
+// band is rescaled to units of g; band cell x then holds the answer for
+// lowEnergy + x * g up to lowEnergy + (x + 1) * g - 1 exactly.
+//
+// A bitset pass then finds the reachable sums. The band is cut at the
+// largest reachable sum (the cells after it repeat it), and when only a
+// small fraction of the cells is reachable the plan is marked for the
+// sparse engine, which stores exactly the reachable sums that improve the
+// time. The pass stops as soon as the sums get dense.
+void mptCompressEnergies(MptPlan& plan)
+{
+    plan.energyScale = 1;
+    plan.sparseEnergies = false;
+
+    int scale = 0;
+    for (const MptJobGroup& group : plan.groups) {
+        for (const Profile& core : group.frontier) {
+            scale = mptGcd(core.energy, scale);
+        }
+    }
+    if (scale > 1) {
+        for (MptJobGroup& group : plan.groups) {
+            for (Profile& core : group.frontier) {
+                core.energy /= scale;
+            }
+        }
+        plan.bandEnergy /= scale;
+        plan.energyScale = scale;
+    }
+
+    const MptConfig& config = mptConfig();
+    if (config.reachabilityMinCells <= 0 || plan.bandEnergy + 1 < config.reachabilityMinCells ||
+        !mptFitsDenseBudget(plan.bandEnergy)) {
+        return;
+    }
+
+    const int nCells = plan.bandEnergy + 1;
+    const int nWords = (nCells + 63) / 64;
+    const uint64_t lastMask = (nCells % 64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (nCells % 64)) - 1;
+    const long long denseCount = (long long)(config.sparseDensity * nCells);
+    std::vector<uint64_t> cur(nWords, 0);
+    std::vector<uint64_t> next(nWords);
+    cur[0] = 1;
+    for (const MptJobGroup& group : plan.groups) {
+        for (int c = 0; c < group.count; c++) {
+            // every frontier starts at energy 0, so next contains cur
+            next = cur;
+            for (size_t k = 1; k < group.frontier.size(); k++) {
+                mptShiftOr(cur.data(), next.data(), nWords, group.frontier[k].energy);
+            }
+            next[nWords - 1] &= lastMask;
+
+            long long reachable = 0;
+            for (uint64_t word : next) {
+                reachable += (long long)std::bitset<64>(word).count();
+            }
+            if (reachable > denseCount) {
+                return;
+            }
+            cur.swap(next);
+        }
+    }
+
+    int w = nWords - 1;
+    while (cur[w] == 0) {
+        w--;
+    }
+    int bit = 63;
+    while (((cur[w] >> bit) & 1) == 0) {
+        bit--;
+    }
+    plan.bandEnergy = w * 64 + bit;
+    plan.sparseEnergies = true;
+}
+
+// Keeps only the profiles that are not dominated by another profile of the
+// same job: sorted by energy, each kept profile is strictly faster than all
+// the cheaper ones. cores receives the input index of every kept profile.
+template<int NCores>
+void mptParetoFrontier(const Profile* job, int nCores,
+    std::vector<Profile>& frontier, std::vector<int>& cores, MptPruneStats& stats)
+{
+    const int n = (NCores > 0) ? NCores : nCores;
+    cores.resize(n);
+    for (int k = 0; k < n; k++) {
+        cores[k] = k;
+    }
+    std::sort(cores.begin(), cores.end(), [job](int a, int b) {
+        return (job[a].energy < job[b].energy) ||
+            (job[a].energy == job[b].energy && job[a].time < job[b].time) ||
+            (job[a].energy == job[b].energy && job[a].time == job[b].time && a < b);
+    });
+
+    frontier.clear();
+    size_t nKept = 0;
+    for (int k = 0; k < n; k++) {
+        const Profile& core = job[cores[k]];
+        if (!frontier.empty() && core.energy == frontier.back().energy) {
+            stats.duplicateEnergy++;
+        }
+        else if (!frontier.empty() && core.time >= frontier.back().time) {
+            stats.dominated++;
+        }
+        else {
+            frontier.push_back(core);
+            cores[nKept++] = cores[k];
+        }
+    }
+    cores.resize(nKept);
+}
+
+// jobAt(i) returns the profiles of job i as a (pointer, count) pair
+template<int NCores, class JobAccessor>
+void mptBuildPlan(int nJobs, JobAccessor jobAt, int maxEnergy, MptPlan& plan)
+{
+    plan.groups.clear();
+    plan.feasible = true;
+    plan.stats = MptPruneStats();
+    plan.stats.jobs = nJobs;
+    plan.coreOffset.assign(1, 0);
+    plan.coreOf.clear();
+
+    std::vector<std::vector<Profile>> frontiers(nJobs);
+    std::vector<int> cores;
+    long long totalMinEnergy = 0;
+    for (int i = 0; i < nJobs; i++) {
+        std::pair<const Profile*, int> job = jobAt(i);
+        plan.stats.profiles += job.second;
+        mptParetoFrontier<NCores>(job.first, job.second, frontiers[i], cores, plan.stats);
+        plan.coreOf.insert(plan.coreOf.end(), cores.begin(), cores.end());
+        plan.coreOffset.push_back(int(plan.coreOf.size()));
+        if (frontiers[i].empty()) {
+            plan.feasible = false;
+            continue;
+        }
+        const int minEnergy = frontiers[i][0].energy;
+        for (Profile& core : frontiers[i]) {
+            core.energy -= minEnergy;
+        }
+        totalMinEnergy += minEnergy;
+    }
+
+    if (!plan.feasible || totalMinEnergy > maxEnergy) {
+        plan.feasible = false;
+        return;
+    }
+    plan.lowEnergy = int(totalMinEnergy);
+    plan.bandEnergy = int(maxEnergy - totalMinEnergy);
+
+    for (std::vector<Profile>& frontier : frontiers) {
+        size_t nFit = 0;
+        while (nFit < frontier.size() && frontier[nFit].energy <= plan.bandEnergy) {
+            nFit++;
+        }
+        plan.stats.overBudget += int(frontier.size() - nFit);
+        frontier.resize(nFit);
+        plan.stats.kept += int(nFit);
+    }
+
+    // The order of the jobs does not change the optimum, so identical
+    // frontiers are merged into one group
+    auto lessFrontier = [](const std::vector<Profile>& a, const std::vector<Profile>& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+            [](const Profile& x, const Profile& y) {
+                return (x.energy < y.energy) || (x.energy == y.energy && x.time < y.time);
+            });
+    };
+    std::vector<int> order(nJobs);
+    for (int i = 0; i < nJobs; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return lessFrontier(frontiers[a], frontiers[b]) ||
+            (!lessFrontier(frontiers[b], frontiers[a]) && a < b);
+    });
+    for (int i : order) {
+        if (!plan.groups.empty() &&
+            !lessFrontier(plan.groups.back().frontier, frontiers[i])) {
+            plan.groups.back().count++;
+            plan.groups.back().jobs.push_back(i);
+        }
+        else {
+            plan.groups.push_back(MptJobGroup{ std::move(frontiers[i]), 1, { i } });
+        }
+    }
+    plan.stats.distinctJobs = int(plan.groups.size());
+    mptCompressEnergies(plan);
+}
+
+// Sparse engine for budgets too large for dense rows. A stage is the list
+// of non-dominated (time, energy) pairs reachable so far: energies increase
+// and times strictly decrease, so only the useful energy levels are stored.
+// The next stage is the k-way merge of the list shifted by every profile of
+// the job, keeping a pair only if it is faster than every cheaper one.
+struct MptMergeCursor
+{
+    Profile head;     // next pair of this shifted copy
+    size_t index;     // position of head in the current list
+    int core;         // profile that shifts this copy
+};
+
+// Where a pair of the next list came from: pair `parent` of the current
+// list plus frontier entry `choice`
+struct MptSparseLink
+{
+    int parent;
+    int choice;
+};
+
+// If links is given, the link of every pair of next is appended to it
+void mptSparseTransition(const std::vector<Profile>& cur, std::vector<Profile>& next,
+    int bandEnergy, const std::vector<Profile>& job, std::vector<MptMergeCursor>& heap,
+    std::vector<MptSparseLink>* links = nullptr)
+{
+    // min-heap on (energy, time)
+    auto after = [](const MptMergeCursor& a, const MptMergeCursor& b) {
+        return (a.head.energy > b.head.energy) ||
+            (a.head.energy == b.head.energy && a.head.time > b.head.time);
+    };
+
+    heap.clear();
+    for (int k = 0; k < int(job.size()); k++) {
+        if (!cur.empty() && cur[0].energy + job[k].energy <= bandEnergy) {
+            Profile head{ mptSaturatingAdd(cur[0].time, job[k].time), cur[0].energy + job[k].energy };
+            heap.push_back(MptMergeCursor{ head, 0, k });
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    next.clear();
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        MptMergeCursor& top = heap.back();
+
+        if (next.empty() || top.head.time < next.back().time) {
+            next.push_back(top.head);
+            if (links != nullptr) {
+                links->push_back(MptSparseLink{ int(top.index), top.core });
+            }
+        }
+
+        const Profile& core = job[top.core];
+        if (++top.index < cur.size() && cur[top.index].energy + core.energy <= bandEnergy) {
+            top.head = Profile{ mptSaturatingAdd(cur[top.index].time, core.time),
+                cur[top.index].energy + core.energy };
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+        else {
+            heap.pop_back();
+        }
+    }
+}
+
+// A group of identical jobs as a single stage: the frontier of all `count`
+// jobs together, built on the sparse engine. Returns false when it has at
+// least as many profiles as the group's stages together, in which case the
+// single stage would do no less work than the separate ones, or when the
+// band is too narrow for the merge to pay for itself.
+bool mptGroupFrontier(const MptJobGroup& group, int bandEnergy, std::vector<Profile>& combined)
+{
+    static thread_local std::vector<Profile> next;
+    static thread_local std::vector<MptMergeCursor> heap;
+
+    const long long separate = (long long)group.count * (long long)group.frontier.size();
+    if (group.count < 2 || 4 * separate > (long long)bandEnergy + 1) {
+        return false;
+    }
+
+    combined.assign(1, Profile{ 0, 0 });
+    for (int c = 0; c < group.count; c++) {
+        mptSparseTransition(combined, next, bandEnergy, group.frontier, heap);
+        combined.swap(next);
+        if ((long long)combined.size() >= separate) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the DP over a built plan and returns the final band row: cell x is
+// the minimum total time with at most plan.lowEnergy + x units of energy.
+// The row is owned by the calling thread and reused by the next solve.
+template<class Cell = int>
+const std::vector<Cell>& mptRunPlan(const MptPlan& plan)
+{
+    static thread_local MptRows<Cell> rows;
+    rows.Reset(plan.bandEnergy);
+
+    // wide rows go to the tiled executor, if it is idle
+    const MptConfig& config = mptConfig();
+    MptStagePool* pool = nullptr;
+    if (config.stageThreads != 1 && config.stageTileCells > 0 &&
+        plan.bandEnergy + 1 >= 2 * config.stageTileCells) {
+        pool = &mptStagePool();
+        if (pool->ThreadCount() < 2 || !pool->TryAcquire()) {
+            pool = nullptr;
+        }
+    }
+
+    static thread_local std::vector<Profile> combined;
+    for (const MptJobGroup& group : plan.groups) {
+        // identical jobs run as one stage when their joint frontier is small
+        const bool isMerged = mptGroupFrontier(group, plan.bandEnergy, combined);
+        const std::vector<Profile>& frontier = isMerged ? combined : group.frontier;
+        const int nStages = isMerged ? 1 : group.count;
+
+        for (int c = 0; c < nStages; c++) {
+            if (pool != nullptr) {
+                pool->RunStage(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+                    frontier, config.stageTileCells);
+            }
+            else {
+                mptTransition(rows.cur.data(), rows.next.data(), plan.bandEnergy, frontier);
+            }
+            rows.cur.swap(rows.next);
+        }
+    }
+
+    if (pool != nullptr) {
+        pool->Release();
+    }
+    return rows.cur;
+}
+
+// Runs the sparse engine over a built plan and returns the final list, with
+// energies relative to plan.lowEnergy
+const std::vector<Profile>& mptRunPlanSparse(const MptPlan& plan)
+{
+    static thread_local std::vector<Profile> cur;
+    static thread_local std::vector<Profile> next;
+    static thread_local std::vector<MptMergeCursor> heap;
+
+    cur.assign(1, Profile{ 0, 0 });
+    for (const MptJobGroup& group : plan.groups) {
+        for (int c = 0; c < group.count; c++) {
+            mptSparseTransition(cur, next, plan.bandEnergy, group.frontier, heap);
+            cur.swap(next);
+        }
+    }
+
+    return cur;
+}
+
+bool mptUseSparseEngine(const MptPlan& plan)
+{
+    return plan.sparseEnergies || !mptFitsDenseBudget(plan.bandEnergy);
+}
+
+// Every cell of a band row is at most the time of running each job on its
+// cheapest profile, which is also cell 0 of the final row. If that bound
+// fits in 16 bits, so does the whole table.
+bool mptUseNarrowCells(const MptPlan& plan)
+{
+    if (!mptConfig().narrowCells) {
+        return false;
+    }
+    long long bound = 0;
+    for (const MptJobGroup& group : plan.groups) {
+        int slowest = 0;
+        for (const Profile& core : group.frontier) {
+            slowest = core.time > slowest ? core.time : slowest;
+        }
+        bound += (long long)group.count * slowest;
+        if (bound >= MptCell<uint16_t>::Infinity()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A narrow row is exact unless cell 0, its largest, saturated
+bool mptNarrowRowExact(const std::vector<uint16_t>& row)
+{
+    return row[0] != MptCell<uint16_t>::Infinity();
+}
+
+// Dual, time-indexed formulation: row t holds the minimum energy of the jobs
+// so far when their total time is at most lowTime + t, and the answer is the
+// smallest time whose energy fits in the budget. Times start at the sum of
+// the fastest affordable profiles and the cheapest profiles give a feasible
+// schedule, so the row only spans sum(cheapest time - fastest time) + 1
+// cells, often far fewer than the energy band when times are small.
+// The dual plan is the primal one with time and energy swapped, so it runs
+// on the same engine; energies stay relative to plan.lowEnergy.
+long long mptTimeBand(const MptPlan& plan, long long& lowTime)
+{
+    lowTime = 0;
+    long long band = 0;
+    for (const MptJobGroup& group : plan.groups) {
+        lowTime += (long long)group.count * group.frontier.back().time;
+        band += (long long)group.count * (group.frontier.front().time - group.frontier.back().time);
+    }
+    return band;
+}
+
+void mptBuildDualPlan(const MptPlan& plan, int timeBand, MptPlan& dual)
+{
+    dual.groups.resize(plan.groups.size());
+    for (size_t g = 0; g < plan.groups.size(); g++) {
+        const std::vector<Profile>& frontier = plan.groups[g].frontier;
+        const int fastest = frontier.back().time;
+        dual.groups[g].count = plan.groups[g].count;
+        dual.groups[g].frontier.clear();
+        for (const Profile& core : frontier) {
+            dual.groups[g].frontier.push_back(Profile{ core.energy, core.time - fastest });
+        }
+    }
+    dual.lowEnergy = 0;
+    dual.bandEnergy = timeBand;
+    dual.feasible = true;
+}
+
+template<class Cell>
+int mptFirstFittingTime(const std::vector<Cell>& row, const MptPlan& plan,
+    long long lowTime, int timeBand)
+{
+    // row is nonincreasing and its last cell fits (all cheapest profiles)
+    auto fits = std::partition_point(row.begin(), row.begin() + timeBand + 1,
+        [&](Cell energy) { return int(energy) > plan.bandEnergy; });
+    return int(lowTime + (fits - row.begin()));
+}
+
+int mptSolveDual(const MptPlan& plan, long long lowTime, int timeBand)
+{
+    static thread_local MptPlan dual;
+    mptBuildDualPlan(plan, timeBand, dual);
+    if (mptUseNarrowCells(dual)) {
+        const std::vector<uint16_t>& row = mptRunPlan<uint16_t>(dual);
+        if (mptNarrowRowExact(row)) {
+            return mptFirstFittingTime(row, plan, lowTime, timeBand);
+        }
+    }
+    return mptFirstFittingTime(mptRunPlan(dual), plan, lowTime, timeBand);
+}
+
+bool mptUseDual(const MptPlan& plan, long long& lowTime, long long& timeBand)
+{
+    const MptFormulation formulation = mptConfig().formulation;
+    if (formulation == MptFormulation::Energy) {
+        return false;
+    }
+    // sparse energy sums are cheaper to list than any dense row
+    if (formulation == MptFormulation::Auto && plan.sparseEnergies) {
+        return false;
+    }
+    timeBand = mptTimeBand(plan, lowTime);
+    if (lowTime + timeBand >= mptInfinity || !mptFitsDenseBudget(timeBand)) {
+        return false;
+    }
+    return (formulation == MptFormulation::Time) || (timeBand < plan.bandEnergy);
+}
+
+int mptSolvePlan(const MptPlan& plan)
+{
+    if (!plan.feasible) {
+        return mptInfinity;
+    }
+    long long lowTime = 0;
+    long long timeBand = 0;
+    if (!plan.groups.empty() && mptUseDual(plan, lowTime, timeBand)) {
+        return mptSolveDual(plan, lowTime, int(timeBand));
+    }
+    if (mptUseSparseEngine(plan)) {
+        const std::vector<Profile>& last = mptRunPlanSparse(plan);
+        return last.empty() ? mptInfinity : last.back().time;
+    }
+    if (mptUseNarrowCells(plan)) {
+        const std::vector<uint16_t>& row = mptRunPlan<uint16_t>(plan);
+        if (mptNarrowRowExact(row)) {
+            return row[plan.bandEnergy];
+        }
+    }
+    return mptRunPlan(plan)[plan.bandEnergy];
+}
+
+// Builds the plan for a flat profile table, templated on its stride (the
+// number of core types). NCores = 0 is the generic path for any other count.
+template<int NCores>
+void mptBuildFlatPlan(const Profile* table, int nJobs, int nCores, int maxEnergy,
+    MptPlan& plan)
+{
+    const int stride = (NCores > 0) ? NCores : nCores;
+    mptBuildPlan<NCores>(nJobs, [=](int i) {
+        return std::make_pair(table + size_t(i) * stride, stride);
+    }, maxEnergy, plan);
+}
+
+void mptBuildPlan(const MptProfileTable& table, int maxEnergy, MptPlan& plan)
+{
+    const Profile* data = table.profiles.data();
+    switch (table.nCores) {
+    case 4: mptBuildFlatPlan<4>(data, table.nJobs, 4, maxEnergy, plan); break;
+    case 8: mptBuildFlatPlan<8>(data, table.nJobs, 8, maxEnergy, plan); break;
+    case 16: mptBuildFlatPlan<16>(data, table.nJobs, 16, maxEnergy, plan); break;
+    case 32: mptBuildFlatPlan<32>(data, table.nJobs, 32, maxEnergy, plan); break;
+    case 64: mptBuildFlatPlan<64>(data, table.nJobs, 64, maxEnergy, plan); break;
+    default: mptBuildFlatPlan<0>(data, table.nJobs, table.nCores, maxEnergy, plan); break;
+    }
+}
+
+void mptBuildPlan(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy, MptPlan& plan)
+{
+    mptBuildPlan<0>(int(profiles.size()), [&](int i) {
+        return std::make_pair(profiles[i].data(), int(profiles[i].size()));
+    }, maxEnergy, plan);
+}
+
+template<class Jobs>
+int mptMinProcessingTime(const Jobs& jobs, int nJobs, int maxEnergy,
+    MptPruneStats* stats)
+{
+    if (maxEnergy < 0) {
+        return (nJobs == 0) ? 0 : mptInfinity;
+    }
+
+    static thread_local MptPlan plan;
+    mptBuildPlan(jobs, maxEnergy, plan);
+    if (stats != nullptr) {
+        *stats = plan.stats;
+    }
+    return mptSolvePlan(plan);
+}
+
+int MinProcessingTime(const MptProfileTable& table, int maxEnergy,
+    MptPruneStats* stats = nullptr)
+{
+    return mptMinProcessingTime(table, table.nJobs, maxEnergy, stats);
+}
+
+int MinProcessingTime(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy, MptPruneStats* stats)
+{
+    return mptMinProcessingTime(profiles, int(profiles.size()), maxEnergy, stats);
+}
+
+int MinProcessingTime(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy)
+{
+    return MinProcessingTime(profiles, maxEnergy, nullptr);
+}
+
+// Minimum processing time for every energy budget from 0 to maxEnergy.
+// The answer only changes at a few budgets, so just those breakpoints are
+// kept: breakpoints[i].time is the answer for every budget in
+// [breakpoints[i].energy, breakpoints[i + 1].energy). Energies increase and
+// times strictly decrease; budgets below the first breakpoint are infeasible.
+struct MptFrontier
+{
+    std::vector<Profile> breakpoints;
+    int maxEnergy {0};
+};
+
+template<class Cell>
+void mptAppendBreakpoints(const std::vector<Cell>& row, const MptPlan& plan,
+    MptFrontier& frontier)
+{
+    for (int x = 0; x <= plan.bandEnergy; x++) {
+        if (row[x] < MptCell<Cell>::Infinity() &&
+            (frontier.breakpoints.empty() || row[x] < frontier.breakpoints.back().time)) {
+            frontier.breakpoints.push_back(Profile{ int(row[x]), plan.lowEnergy + x * plan.energyScale });
+        }
+    }
+}
+
+void mptExtractFrontier(const MptPlan& plan, int maxEnergy, MptFrontier& frontier)
+{
+    frontier.breakpoints.clear();
+    frontier.maxEnergy = maxEnergy;
+    if (!plan.feasible) {
+        return;
+    }
+
+    if (mptUseSparseEngine(plan)) {
+        for (const Profile& point : mptRunPlanSparse(plan)) {
+            frontier.breakpoints.push_back(Profile{ point.time,
+                plan.lowEnergy + point.energy * plan.energyScale });
+        }
+        return;
+    }
+
+    if (mptUseNarrowCells(plan)) {
+        const std::vector<uint16_t>& row = mptRunPlan<uint16_t>(plan);
+        if (mptNarrowRowExact(row)) {
+            mptAppendBreakpoints(row, plan, frontier);
+            return;
+        }
+    }
+    mptAppendBreakpoints(mptRunPlan(plan), plan, frontier);
+}
+
+template<class Jobs>
+MptFrontier mptEnergyFrontier(const Jobs& jobs, int nJobs, int maxEnergy)
+{
+    MptFrontier frontier;
+    frontier.maxEnergy = maxEnergy;
+    if (maxEnergy < 0) {
+        return frontier;
+    }
+    if (nJobs == 0) {
+        frontier.breakpoints.push_back(Profile{ 0, 0 });
+        return frontier;
+    }
+
+    static thread_local MptPlan plan;
+    mptBuildPlan(jobs, maxEnergy, plan);
+    mptExtractFrontier(plan, maxEnergy, frontier);
+    return frontier;
+}
+
+// One solve for all budgets up to maxEnergy; query it with FrontierTime
+MptFrontier MinProcessingTimeFrontier(const MptProfileTable& table, int maxEnergy)
+{
+    return mptEnergyFrontier(table, table.nJobs, maxEnergy);
+}
+
+MptFrontier MinProcessingTimeFrontier(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy)
+{
+    return mptEnergyFrontier(profiles, int(profiles.size()), maxEnergy);
+}
+
+// Minimum processing time for the given budget, in O(log breakpoints).
+// Only budgets up to the frontier's maxEnergy were solved; larger ones
+// return -1, since a bigger budget may allow a faster schedule.
+int FrontierTime(const MptFrontier& frontier, int budget)
+{
+    if (budget > frontier.maxEnergy) {
+        return -1;
+    }
+
+    auto it = std::upper_bound(frontier.breakpoints.begin(), frontier.breakpoints.end(),
+        budget, [](int energy, const Profile& point) { return energy < point.energy; });
+
+    if (it == frontier.breakpoints.begin()) {
+        return mptInfinity;
+    }
+    return std::prev(it)->time;
+}
+
+// Core choices of every (stage, energy) cell, packed into `bits` bits per
+// cell. Eight core types need 3 bits, 8x less than an int per cell.
+class MptChoiceTable
+{
+public:
+    void Reset(int nRows, int rowLength, int bitsPerChoice)
+    {
+        length = rowLength;
+        bits = bitsPerChoice;
+        size_t totalBits = size_t(nRows) * size_t(rowLength) * size_t(bits);
+        words.assign(totalBits / 64 + 2, 0);
+    }
+
+    void Set(int row, int cell, int choice)
+    {
+        const size_t pos = (size_t(row) * length + cell) * bits;
+        const size_t word = pos / 64;
+        const int shift = int(pos % 64);
+        const uint64_t mask = (uint64_t(1) << bits) - 1;
+        words[word] = (words[word] & ~(mask << shift)) | (uint64_t(choice) << shift);
+        if (shift + bits > 64) {
+            const int spill = 64 - shift;
+            words[word + 1] = (words[word + 1] & ~(mask >> spill)) | (uint64_t(choice) >> spill);
+        }
+    }
+
+    int Get(int row, int cell) const
+    {
+        const size_t pos = (size_t(row) * length + cell) * bits;
+        const size_t word = pos / 64;
+        const int shift = int(pos % 64);
+        uint64_t value = words[word] >> shift;
+        if (shift + bits > 64) {
+            value |= words[word + 1] << (64 - shift);
+        }
+        return int(value & ((uint64_t(1) << bits) - 1));
+    }
+
+    static size_t Bytes(int nRows, int rowLength, int bitsPerChoice)
+    {
+        return (size_t(nRows) * size_t(rowLength) * size_t(bitsPerChoice)) / 8 + 16;
+    }
+
+private:
+    std::vector<uint64_t> words;
+    int length {0};
+    int bits {1};
+};
+
+// Stage transition that also records which frontier entry won each cell.
+// Ties go to the cheaper profile.
+void mptTransitionArgmin(const int* cur, int* next, int bandEnergy,
+    const std::vector<Profile>& job, MptChoiceTable& choices, int row)
+{
+    const int n = int(job.size());
+    for (int x = 0; x <= bandEnergy; x++) {
+        int best = mptInfinity;
+        int choice = 0;
+        for (int k = 0; k < n && job[k].energy <= x; k++) {
+            int candidate = mptSaturatingAdd(cur[x - job[k].energy], job[k].time);
+            if (candidate < best) {
+                best = candidate;
+                choice = k;
+            }
+        }
+        next[x] = best;
+        choices.Set(row, x, choice);
+    }
+}
+
+enum class MptAssignmentMode
+{
+    Auto,          // Packed if it fits in the dense memory budget, else the smaller one
+    Packed,        // choices of all stages, O(jobs * E) bits
+    Checkpoint,    // rows every sqrt(jobs) stages, recomputed backwards: O(E * sqrt(jobs))
+    Sparse         // Pareto list of every stage with parent links; always used
+                   // for plans that run on the sparse engine
+};
+
+// Deadline of an anytime solve, checked between DP stages. The default
+// never passes.
+struct MptDeadline
+{
+    bool enabled {false};
+    std::chrono::steady_clock::time_point at;
+
+    bool Passed() const { return enabled && std::chrono::steady_clock::now() >= at; }
+};
+
+// Stage s of the plan runs job stageJob[s] with frontier stageGroup[s]
+struct MptStages
+{
+    std::vector<int> stageGroup;
+    std::vector<int> stageJob;
+    int bits {1};
+
+    void Build(const MptPlan& plan)
+    {
+        stageGroup.clear();
+        stageJob.clear();
+        size_t widest = 1;
+        for (int g = 0; g < int(plan.groups.size()); g++) {
+            widest = std::max(widest, plan.groups[g].frontier.size());
+            for (int job : plan.groups[g].jobs) {
+                stageGroup.push_back(g);
+                stageJob.push_back(job);
+            }
+        }
+        bits = 1;
+        while ((size_t(1) << bits) < widest) {
+            bits++;
+        }
+    }
+
+    int Count() const { return int(stageGroup.size()); }
+};
+
+// Walks back over stages [first, last] from band cell x, writing the core of
+// every job to assignment. Returns the cell before stage first.
+int mptWalkBack(const MptPlan& plan, const MptStages& stages, const MptChoiceTable& choices,
+    int first, int last, int x, std::vector<int>& assignment)
+{
+    for (int s = last; s >= first; s--) {
+        const int f = choices.Get(s - first, x);
+        const int job = stages.stageJob[s];
+        assignment[job] = plan.coreOf[plan.coreOffset[job] + f];
+        x -= plan.groups[stages.stageGroup[s]].frontier[f].energy;
+    }
+    return x;
+}
+
+// Both assignment passes return -1 if the deadline passes before the
+// optimum is known. If it passes later, the optimum is returned and the
+// assignment is cleared.
+int mptAssignPacked(const MptPlan& plan, const MptStages& stages, std::vector<int>& assignment,
+    const MptDeadline& deadline = MptDeadline())
+{
+    const int nStages = stages.Count();
+    MptRows<> rows;
+    rows.Reset(plan.bandEnergy);
+    MptChoiceTable choices;
+    choices.Reset(nStages, plan.bandEnergy + 1, stages.bits);
+
+    for (int s = 0; s < nStages; s++) {
+        if (deadline.Passed()) {
+            return -1;
+        }
+        mptTransitionArgmin(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+            plan.groups[stages.stageGroup[s]].frontier, choices, s);
+        rows.cur.swap(rows.next);
+    }
+
+    const int answer = rows.cur[plan.bandEnergy];
+    if (answer < mptInfinity) {
+        mptWalkBack(plan, stages, choices, 0, nStages - 1, plan.bandEnergy, assignment);
+    }
+    return answer;
+}
+
+int mptAssignCheckpoint(const MptPlan& plan, const MptStages& stages, std::vector<int>& assignment,
+    const MptDeadline& deadline = MptDeadline())
+{
+    const int nStages = stages.Count();
+    const size_t rowLength = size_t(plan.bandEnergy) + 1;
+    int segment = 1;
+    while (segment * segment < nStages) {
+        segment++;
+    }
+    const int nSegments = (nStages + segment - 1) / segment;
+
+    // forward pass, keeping the row in front of every segment
+    std::vector<int> checkpoints(size_t(nSegments) * rowLength);
+    MptRows<> rows;
+    rows.Reset(plan.bandEnergy);
+    for (int s = 0; s < nStages; s++) {
+        if (deadline.Passed()) {
+            return -1;
+        }
+        if (s % segment == 0) {
+            std::copy(rows.cur.begin(), rows.cur.end(),
+                checkpoints.begin() + size_t(s / segment) * rowLength);
+        }
+        mptTransition(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+            plan.groups[stages.stageGroup[s]].frontier);
+        rows.cur.swap(rows.next);
+    }
+
+    const int answer = rows.cur[plan.bandEnergy];
+    if (answer >= mptInfinity) {
+        return answer;
+    }
+
+    // backward pass: recompute one segment at a time with its choices
+    MptChoiceTable choices;
+    choices.Reset(segment, int(rowLength), stages.bits);
+    int x = plan.bandEnergy;
+    for (int seg = nSegments - 1; seg >= 0; seg--) {
+        const int first = seg * segment;
+        const int last = std::min(nStages, first + segment) - 1;
+        std::copy(checkpoints.begin() + size_t(seg) * rowLength,
+            checkpoints.begin() + size_t(seg + 1) * rowLength, rows.cur.begin());
+        for (int s = first; s <= last; s++) {
+            if (deadline.Passed()) {
+                assignment.clear();
+                return answer;
+            }
+            mptTransitionArgmin(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+                plan.groups[stages.stageGroup[s]].frontier, choices, s - first);
+            rows.cur.swap(rows.next);
+        }
+        x = mptWalkBack(plan, stages, choices, first, last, x, assignment);
+    }
+    return answer;
+}
+
+// Bytes of the checkpoint rows and of the choices of one segment
+size_t mptCheckpointBytes(int nStages, int rowLength, int bitsPerChoice)
+{
+    int segment = 1;
+    while (segment * segment < nStages) {
+        segment++;
+    }
+    const int nSegments = (nStages + segment - 1) / segment;
+    return size_t(nSegments) * size_t(rowLength) * sizeof(int) +
+        MptChoiceTable::Bytes(segment, rowLength, bitsPerChoice);
+}
+
+// Sparse engine with the list of every stage kept as parent links, so its
+// memory is the total length of the lists rather than jobs * E cells
+int mptAssignSparse(const MptPlan& plan, const MptStages& stages, std::vector<int>& assignment,
+    const MptDeadline& deadline = MptDeadline())
+{
+    const int nStages = stages.Count();
+    std::vector<Profile> cur(1, Profile{ 0, 0 });
+    std::vector<Profile> next;
+    std::vector<MptMergeCursor> heap;
+    std::vector<MptSparseLink> links;
+    std::vector<size_t> stageStart(nStages);
+
+    for (int s = 0; s < nStages; s++) {
+        if (deadline.Passed()) {
+            return -1;
+        }
+        stageStart[s] = links.size();
+        mptSparseTransition(cur, next, plan.bandEnergy,
+            plan.groups[stages.stageGroup[s]].frontier, heap, &links);
+        cur.swap(next);
+    }
+
+    if (cur.empty()) {
+        return mptInfinity;
+    }
+
+    // the last pair of the final list is the fastest within the band
+    int index = int(cur.size()) - 1;
+    for (int s = nStages - 1; s >= 0; s--) {
+        const MptSparseLink& link = links[stageStart[s] + index];
+        const int job = stages.stageJob[s];
+        assignment[job] = plan.coreOf[plan.coreOffset[job] + link.choice];
+        index = link.parent;
+    }
+    return cur.back().time;
+}
+
+int mptAssign(const MptPlan& plan, const MptStages& stages, MptAssignmentMode mode,
+    std::vector<int>& assignment, const MptDeadline& deadline = MptDeadline())
+{
+    if (mptUseSparseEngine(plan)) {
+        mode = MptAssignmentMode::Sparse;
+    }
+    else if (mode == MptAssignmentMode::Auto) {
+        const size_t packedBytes = MptChoiceTable::Bytes(stages.Count(), plan.bandEnergy + 1, stages.bits);
+        const size_t checkpointBytes = mptCheckpointBytes(stages.Count(), plan.bandEnergy + 1, stages.bits);
+        mode = (packedBytes <= mptConfig().denseMemoryBudget || packedBytes <= checkpointBytes) ?
+            MptAssignmentMode::Packed : MptAssignmentMode::Checkpoint;
+    }
+
+    switch (mode) {
+    case MptAssignmentMode::Sparse: return mptAssignSparse(plan, stages, assignment, deadline);
+    case MptAssignmentMode::Checkpoint: return mptAssignCheckpoint(plan, stages, assignment, deadline);
+    default: return mptAssignPacked(plan, stages, assignment, deadline);
+    }
+}
+
+template<class Jobs>
+int mptMinProcessingTimeAssignment(const Jobs& jobs, int nJobs, int maxEnergy,
+    std::vector<int>& assignment, MptAssignmentMode mode)
+{
+    assignment.clear();
+    if (maxEnergy < 0) {
+        return (nJobs == 0) ? 0 : mptInfinity;
+    }
+
+    MptPlan plan;
+    mptBuildPlan(jobs, maxEnergy, plan);
+    if (!plan.feasible) {
+        return mptInfinity;
+    }
+
+    MptStages stages;
+    stages.Build(plan);
+
+    assignment.assign(nJobs, -1);
+    const int answer = mptAssign(plan, stages, mode, assignment);
+    if (answer >= mptInfinity) {
+        assignment.clear();
     }
-    if (OPT[i][mE] !=  -1)  {
-        return OPT[i][mE];
+    return answer;
+}
+
+// Minimum processing time together with an optimal schedule: assignment[i]
+// is the core (index into the profiles of job i) that job i runs on.
+// The assignment is empty when no schedule fits in maxEnergy.
+int MinProcessingTime(const std::vector<std::vector<Profile>>& profiles, int maxEnergy,
+    std::vector<int>& assignment, MptAssignmentMode mode = MptAssignmentMode::Auto)
+{
+    return mptMinProcessingTimeAssignment(profiles, int(profiles.size()), maxEnergy,
+        assignment, mode);
+}
+
+int MinProcessingTime(const MptProfileTable& table, int maxEnergy,
+    std::vector<int>& assignment, MptAssignmentMode mode = MptAssignmentMode::Auto)
+{
+    return mptMinProcessingTimeAssignment(table, table.nJobs, maxEnergy, assignment, mode);
+}
+
+// Runs stages [first, last) from the empty schedule. All cells are finite:
+// in band coordinates every frontier starts at energy 0.
+void mptRunStages(const MptPlan& plan, const MptStages& stages, int first, int last,
+    std::vector<int>& row)
+{
+    MptRows<> rows;
+    rows.Reset(plan.bandEnergy);
+    for (int s = first; s < last; s++) {
+        mptTransition(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+            plan.groups[stages.stageGroup[s]].frontier);
+        rows.cur.swap(rows.next);
     }
-    std::priority_queue <int, std::vector<int>, std::greater<int>> arrOfPaths;
-    for (int k = 0; k < 8; k++) {
-        int shell;
-        if (mE - p[i - 1][k].energy >= 0) {
-            shell = p[i - 1][k].time + mptRecHelper(p, mE - p[i - 1][k].energy, i - 1, OPT);
-            if (shell < inf_num) {
-                arrOfPaths.push(shell);
-            }
+    row.swap(rows.cur);
+}
+
+// Rows are nonincreasing; convex means the decrements shrink
+bool mptIsConvex(const std::vector<int>& row)
+{
+    for (size_t x = 2; x < row.size(); x++) {
+        if (row[x] - row[x - 1] < row[x - 1] - row[x - 2]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// out[x] = min over y <= x of a[y] + b[x - y], for convex a and b: the
+// result is convex too, and its decrements are the merged decrements of a
+// and b. O(E).
+void mptConvolveConvex(const std::vector<int>& a, const std::vector<int>& b,
+    std::vector<int>& out)
+{
+    const size_t n = a.size();
+    out.resize(n);
+    out[0] = mptSaturatingAdd(a[0], b[0]);
+    size_t i = 1;
+    size_t j = 1;
+    for (size_t x = 1; x < n; x++) {
+        const int stepA = a[i] - a[i - 1];
+        const int stepB = b[j] - b[j - 1];
+        if (stepA <= stepB) {
+            out[x] = out[x - 1] + stepA;
+            i++;
+        }
+        else {
+            out[x] = out[x - 1] + stepB;
+            j++;
+        }
+    }
+}
+
+// Same convolution when only b is convex. The best split y of cell x is then
+// monotone in x, so the cells are solved divide and conquer: the middle cell
+// first, then each half only searches its side of the middle's split.
+// O(E log E).
+void mptConvolveMonotone(const std::vector<int>& a, const std::vector<int>& b,
+    std::vector<int>& out, int lo, int hi, int yLo, int yHi)
+{
+    if (lo > hi) {
+        return;
+    }
+    const int x = lo + (hi - lo) / 2;
+    int best = mptInfinity;
+    int bestY = yLo;
+    const int yEnd = std::min(x, yHi);
+    for (int y = yLo; y <= yEnd; y++) {
+        int candidate = mptSaturatingAdd(a[y], b[x - y]);
+        if (candidate < best) {
+            best = candidate;
+            bestY = y;
+        }
+    }
+    out[x] = best;
+    mptConvolveMonotone(a, b, out, lo, x - 1, yLo, bestY);
+    mptConvolveMonotone(a, b, out, x + 1, hi, bestY, yHi);
+}
+
+// General (min,+) convolution of two band rows, O(E^2)
+void mptConvolveGeneral(const std::vector<int>& a, const std::vector<int>& b,
+    std::vector<int>& out)
+{
+    const int n = int(a.size());
+    out.assign(n, mptInfinity);
+    for (int y = 0; y < n; y++) {
+        const int base = a[y];
+        const int* tail = b.data();
+        int* dest = out.data() + y;
+        for (int z = 0; z + y < n; z++) {
+            int candidate = mptSaturatingAdd(tail[z], base);
+            dest[z] = candidate < dest[z] ? candidate : dest[z];
         }
     }
-    if (arrOfPaths.size() > 0) {
-        int OPT_val = arrOfPaths.top();
-        OPT[i][mE] = OPT_val;
-        return OPT[i][mE];
+}
+
+void mptConvolve(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& out)
+{
+    const bool convexA = mptIsConvex(a);
+    const bool convexB = mptIsConvex(b);
+    if (convexA && convexB) {
+        mptConvolveConvex(a, b, out);
+    }
+    else if (convexA || convexB) {
+        out.resize(a.size());
+        const int last = int(a.size()) - 1;
+        if (convexB) {
+            mptConvolveMonotone(a, b, out, 0, last, 0, last);
+        }
+        else {
+            mptConvolveMonotone(b, a, out, 0, last, 0, last);
+        }
     }
     else {
-        return inf_num;
+        mptConvolveGeneral(a, b, out);
     }
 }
 
-int MinProcessingTime(const std::vector<std::vector<Profile>>& profiles,
-    int maxEnergy)
+// Parallel engine for a single instance. The stages are split into one
+// chunk per thread and every chunk's full energy-to-time row is computed
+// independently; the rows are then combined pairwise by (min,+) convolution
+// in a reduction tree, each level in parallel. The chain of jobs thus turns
+// into log-depth work at the price of O(E^2) general convolutions (O(E) or
+// O(E log E) when the rows are convex), so it pays off for many jobs over a
+// moderate energy range. Huge budgets use the sequential sparse engine, and
+// when the general convolutions would cost more than the DP itself, the
+// stages after the first chunk run sequentially instead.
+template<class Jobs>
+int mptMinProcessingTimeParallel(const Jobs& jobs, int nJobs, int maxEnergy, int nThreads)
 {
-    // The number of cores is fixed. You can assume that it is always equal to 8.   
-    const int nCores = 8;
-    int** resultTable;
-    resultTable = new int* [profiles.size()+1];
-    for (int i = 0; i <= profiles.size(); i++) {
-        resultTable[i] = new int[maxEnergy + 1];
-    }
-    
-    
-    for (int i = 0; i <= profiles.size(); i++)
-        for (int j = 0; j < maxEnergy + 1; j++)
-            resultTable[i][j] = -1;
-           
-    //std::vector<std::vector<int>> resultTable(profiles.size()+1, std::vector<int>(maxEnergy + 1, -1));    
-    int answer = mptRecHelper(profiles, maxEnergy, profiles.size(), resultTable);
-    return answer;
+    if (maxEnergy < 0) {
+        return (nJobs == 0) ? 0 : mptInfinity;
+    }
+
+    MptPlan plan;
+    mptBuildPlan(jobs, maxEnergy, plan);
+    if (!plan.feasible) {
+        return mptInfinity;
+    }
+
+    MptStages stages;
+    stages.Build(plan);
+    const int nStages = stages.Count();
+    if (nThreads <= 0) {
+        nThreads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    nThreads = std::min(nThreads, nStages / 2);
+    if (nThreads <= 1 || mptUseSparseEngine(plan)) {
+        return mptSolvePlan(plan);
+    }
+
+    // chunks of about equal transition work
+    size_t totalWork = 0;
+    for (int s = 0; s < nStages; s++) {
+        totalWork += plan.groups[stages.stageGroup[s]].frontier.size();
+    }
+    std::vector<int> bounds(1, 0);
+    size_t work = 0;
+    for (int s = 0; s < nStages; s++) {
+        work += plan.groups[stages.stageGroup[s]].frontier.size();
+        if (int(bounds.size()) < nThreads && work * nThreads >= totalWork * bounds.size()) {
+            bounds.push_back(s + 1);
+        }
+    }
+    if (bounds.back() != nStages) {
+        bounds.push_back(nStages);
+    }
+
+    const int nChunks = int(bounds.size()) - 1;
+    std::vector<std::vector<int>> partial(nChunks);
+    std::vector<std::thread> workers;
+    for (int c = 0; c < nChunks; c++) {
+        workers.emplace_back([&, c]() {
+            mptRunStages(plan, stages, bounds[c], bounds[c + 1], partial[c]);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Two rows that are both non-convex need the O(E^2) convolution. Each
+    // merge has a non-convex operand only if some chunk below it has one, so
+    // there are at most nonConvex - 1 such merges; if they cost more than
+    // the sequential DP, the remaining stages run sequentially from chunk 0.
+    int nonConvex = 0;
+    for (const std::vector<int>& row : partial) {
+        nonConvex += mptIsConvex(row) ? 0 : 1;
+    }
+    const double nCells = double(plan.bandEnergy) + 1;
+    if (nonConvex >= 2 && (nonConvex - 1) * nCells * nCells > double(totalWork) * nCells) {
+        MptRows<> rows;
+        rows.Reset(plan.bandEnergy);
+        rows.cur.swap(partial[0]);
+        for (int s = bounds[1]; s < nStages; s++) {
+            mptTransition(rows.cur.data(), rows.next.data(), plan.bandEnergy,
+                plan.groups[stages.stageGroup[s]].frontier);
+            rows.cur.swap(rows.next);
+        }
+        return rows.cur[plan.bandEnergy];
+    }
+
+    for (int width = 1; width < nChunks; width *= 2) {
+        workers.clear();
+        for (int c = 0; c + width < nChunks; c += 2 * width) {
+            workers.emplace_back([&, c, width]() {
+                std::vector<int> combined;
+                mptConvolve(partial[c], partial[c + width], combined);
+                partial[c].swap(combined);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    return partial[0][plan.bandEnergy];
+}
+
+// MinProcessingTime on several threads; nThreads = 0 uses all hardware threads
+int MinProcessingTimeParallel(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy, int nThreads = 0)
+{
+    return mptMinProcessingTimeParallel(profiles, int(profiles.size()), maxEnergy, nThreads);
+}
+
+int MinProcessingTimeParallel(const MptProfileTable& table, int maxEnergy, int nThreads = 0)
+{
+    return mptMinProcessingTimeParallel(table, table.nJobs, maxEnergy, nThreads);
+}
+
+// State of an MptOnlineSolver, for what-if branches
+struct MptOnlineSnapshot
+{
+    std::vector<int> row;
+    int lowEnergy {0};
+    int nJobs {0};
+    bool feasible {true};
+    MptPruneStats stats;       // of the jobs in this state
+};
+
+// MinProcessingTime for jobs that arrive one at a time. The solver keeps the
+// DP row of the jobs added so far, relative to the sum of their minimum
+// energies like the band of a plan, so adding a job is a single stage over
+// what is left of the band: O(profiles * maxEnergy) at worst. Save copies
+// the row for a what-if branch and Restore returns to it without
+// reallocating.
+class MptOnlineSolver
+{
+public:
+    explicit MptOnlineSolver(int maxEnergy) : maxEnergy(maxEnergy)
+    {
+        state.feasible = (maxEnergy >= 0);
+        if (state.feasible) {
+            state.row.assign(size_t(maxEnergy) + 1, 0);
+        }
+    }
+
+    void AddJob(const Profile* profiles, int nCores)
+    {
+        state.nJobs++;
+        state.stats.jobs++;
+        state.stats.distinctJobs++;   // every job is a stage of its own
+        state.stats.profiles += nCores;
+        if (!state.feasible) {
+            return;
+        }
+
+        mptParetoFrontier<0>(profiles, nCores, frontier, cores, state.stats);
+        const int band = int(state.row.size()) - 1;
+        if (frontier.empty() || frontier[0].energy > band) {
+            state.feasible = false;
+            state.row.clear();
+            return;
+        }
+
+        const int minEnergy = frontier[0].energy;
+        const int nextBand = band - minEnergy;
+        size_t nFit = 0;
+        for (Profile& core : frontier) {
+            core.energy -= minEnergy;
+            nFit += (core.energy <= nextBand) ? 1 : 0;
+        }
+        state.stats.overBudget += int(frontier.size() - nFit);
+        state.stats.kept += int(nFit);
+        frontier.resize(nFit);
+
+        next.resize(size_t(nextBand) + 1);
+        mptTransition(state.row.data(), next.data(), nextBand, frontier);
+        state.row.swap(next);
+        state.lowEnergy += minEnergy;
+    }
+
+    void AddJob(const std::vector<Profile>& profiles)
+    {
+        AddJob(profiles.data(), int(profiles.size()));
+    }
+
+    // Minimum processing time of the jobs so far within maxEnergy
+    int Optimum() const
+    {
+        if (state.nJobs == 0) {
+            return 0;
+        }
+        return state.feasible ? state.row.back() : mptInfinity;
+    }
+
+    // Same for a smaller budget, in O(1). Budgets above maxEnergy are not
+    // tracked and return -1, as in FrontierTime.
+    int Optimum(int budget) const
+    {
+        if (budget > maxEnergy) {
+            return -1;
+        }
+        if (state.nJobs == 0 && budget >= 0) {
+            return 0;
+        }
+        if (!state.feasible || budget < state.lowEnergy) {
+            return mptInfinity;
+        }
+        return state.row[budget - state.lowEnergy];
+    }
+
+    int JobCount() const { return state.nJobs; }
+    int MaxEnergy() const { return maxEnergy; }
+    const MptPruneStats& Stats() const { return state.stats; }
+
+    MptOnlineSnapshot Save() const { return state; }
+
+    void Restore(const MptOnlineSnapshot& snapshot)
+    {
+        state.row.assign(snapshot.row.begin(), snapshot.row.end());
+        state.lowEnergy = snapshot.lowEnergy;
+        state.nJobs = snapshot.nJobs;
+        state.feasible = snapshot.feasible;
+        state.stats = snapshot.stats;
+    }
+
+private:
+    int maxEnergy;
+    MptOnlineSnapshot state;
+    std::vector<int> next;
+    std::vector<Profile> frontier;
+    std::vector<int> cores;
+};
+
+// Result of MinProcessingTimeAnytime
+struct MptAnytimeResult
+{
+    int answer {mptInfinity};       // total time of the best schedule found
+    int lowerBound {mptInfinity};   // no schedule within the budget is faster
+    std::vector<int> assignment;    // core of every job in that schedule
+    int rounds {0};                 // DP refinements that finished in time
+    bool exact {false};             // answer == lowerBound
+
+    // Relative distance between the answer and the bound
+    double Gap() const
+    {
+        return (answer <= 0 || answer >= mptInfinity) ? 0.0 :
+            double(answer - lowerBound) / double(answer);
+    }
+};
+
+// Upgrade from hull point `from` to from + 1 of stage `stage`
+struct MptUpgrade
+{
+    int stage;
+    int from;
+    long long saved;    // time saved
+    long long cost;     // extra energy
+};
+
+// Lower convex hull of a frontier (energies increase, times decrease), as
+// indices into it
+void mptLowerHull(const std::vector<Profile>& frontier, std::vector<int>& hull)
+{
+    hull.clear();
+    for (int f = 0; f < int(frontier.size()); f++) {
+        while (hull.size() >= 2) {
+            const Profile& a = frontier[hull[hull.size() - 2]];
+            const Profile& b = frontier[hull.back()];
+            const Profile& c = frontier[f];
+            // drop b if it is on or above the segment from a to c
+            if ((long long)(b.time - a.time) * (c.energy - a.energy) >=
+                (long long)(c.time - a.time) * (b.energy - a.energy)) {
+                hull.pop_back();
+            }
+            else {
+                break;
+            }
+        }
+        hull.push_back(f);
+    }
+}
+
+// Immediate answer of the anytime solver. The LP relaxation of the
+// multiple-choice knapsack is solved greedily: every job starts on its
+// cheapest profile, then upgrades along the lower hulls are bought by time
+// saved per unit of energy until the first one that does not fit, which
+// the LP takes fractionally. That gives the lower bound; the greedy schedule
+// keeps buying upgrades that still fit, then tries one switch per job to
+// any frontier entry the leftover energy pays for.
+// choice[s] is the frontier entry of stage s.
+void mptGreedySchedule(const MptPlan& plan, const MptStages& stages,
+    std::vector<int>& choice, long long& time, long long& lowerBound)
+{
+    const int nStages = stages.Count();
+    std::vector<std::vector<int>> hulls(plan.groups.size());
+    for (size_t g = 0; g < plan.groups.size(); g++) {
+        mptLowerHull(plan.groups[g].frontier, hulls[g]);
+    }
+
+    std::vector<MptUpgrade> upgrades;
+    time = 0;
+    for (int s = 0; s < nStages; s++) {
+        const std::vector<Profile>& frontier = plan.groups[stages.stageGroup[s]].frontier;
+        const std::vector<int>& hull = hulls[stages.stageGroup[s]];
+        time += frontier[0].time;
+        for (int h = 0; h + 1 < int(hull.size()); h++) {
+            upgrades.push_back(MptUpgrade{ s, h,
+                (long long)frontier[hull[h]].time - frontier[hull[h + 1]].time,
+                (long long)frontier[hull[h + 1]].energy - frontier[hull[h]].energy });
+        }
+    }
+    std::sort(upgrades.begin(), upgrades.end(), [](const MptUpgrade& a, const MptUpgrade& b) {
+        const long long lhs = a.saved * b.cost;
+        const long long rhs = b.saved * a.cost;
+        return (lhs > rhs) || (lhs == rhs && (a.stage < b.stage || (a.stage == b.stage && a.from < b.from)));
+    });
+
+    std::vector<int> position(nStages, 0);
+    long long energyLeft = plan.bandEnergy;
+    bool split = false;
+    lowerBound = -1;
+    for (const MptUpgrade& upgrade : upgrades) {
+        if (position[upgrade.stage] != upgrade.from) {
+            continue;
+        }
+        if (upgrade.cost <= energyLeft) {
+            energyLeft -= upgrade.cost;
+            time -= upgrade.saved;
+            position[upgrade.stage]++;
+        }
+        else if (!split) {
+            split = true;
+            lowerBound = time - upgrade.saved * energyLeft / upgrade.cost;
+        }
+    }
+    if (!split) {
+        lowerBound = time;
+    }
+
+    choice.resize(nStages);
+    for (int s = 0; s < nStages; s++) {
+        const std::vector<Profile>& frontier = plan.groups[stages.stageGroup[s]].frontier;
+        int f = hulls[stages.stageGroup[s]][position[s]];
+        int best = f;
+        for (int k = 0; k < int(frontier.size()); k++) {
+            if (frontier[k].time < frontier[best].time &&
+                frontier[k].energy - frontier[f].energy <= energyLeft) {
+                best = k;
+            }
+        }
+        energyLeft -= frontier[best].energy - frontier[f].energy;
+        time -= frontier[f].time - frontier[best].time;
+        choice[s] = best;
+    }
+}
+
+// One refinement: the dual DP with times rounded up to multiples of
+// `scale`, recording the choices so the schedule can be walked back. The
+// smallest scaled time x whose energy fits proves
+//    optimum >= lowTime + scale * x - nStages * (scale - 1)
+// and the schedule found is feasible. Returns false if the deadline passed
+// or the choice table does not fit in the dense memory budget.
+bool mptScaledDualRound(const MptPlan& plan, const MptStages& stages, long long scale,
+    const MptDeadline& deadline,
+    std::vector<int>& choice, long long& lowerBound)
+{
+    const int nStages = stages.Count();
+
+    // approximate plan: frontiers sorted by rounded time, energy as the cell
+    // value; coreOf maps back to entries of the plan's frontiers
+    MptPlan dual;
+    dual.groups.resize(plan.groups.size());
+    long long band = 0;
+    long long lowTime = 0;
+    for (size_t g = 0; g < plan.groups.size(); g++) {
+        const std::vector<Profile>& frontier = plan.groups[g].frontier;
+        const int fastest = frontier.back().time;
+        dual.groups[g].count = plan.groups[g].count;
+        dual.groups[g].jobs = plan.groups[g].jobs;
+        for (int f = int(frontier.size()) - 1; f >= 0; f--) {
+            const int rounded = int((frontier[f].time - fastest + scale - 1) / scale);
+            dual.groups[g].frontier.push_back(Profile{ frontier[f].energy, rounded });
+        }
+        band += (long long)plan.groups[g].count * dual.groups[g].frontier.back().energy;
+        lowTime += (long long)plan.groups[g].count * fastest;
+    }
+    std::vector<int> frontierSize(plan.coreOffset.size() - 1, 0);
+    for (const MptJobGroup& group : plan.groups) {
+        for (int job : group.jobs) {
+            frontierSize[job] = int(group.frontier.size());
+        }
+    }
+    dual.coreOffset.assign(1, 0);
+    for (int job = 0; job < int(frontierSize.size()); job++) {
+        dual.coreOffset.push_back(dual.coreOffset[job] + frontierSize[job]);
+        for (int f = frontierSize[job] - 1; f >= 0; f--) {
+            dual.coreOf.push_back(f);
+        }
+    }
+
+    if (band >= mptInfinity ||
+        MptChoiceTable::Bytes(nStages, int(band) + 1, stages.bits) > mptConfig().denseMemoryBudget) {
+        return false;
+    }
+    dual.bandEnergy = int(band);
+
+    MptRows<> rows;
+    rows.Reset(dual.bandEnergy);
+    MptChoiceTable choices;
+    choices.Reset(nStages, dual.bandEnergy + 1, stages.bits);
+    for (int s = 0; s < nStages; s++) {
+        if (deadline.Passed()) {
+            return false;
+        }
+        mptTransitionArgmin(rows.cur.data(), rows.next.data(), dual.bandEnergy,
+            dual.groups[stages.stageGroup[s]].frontier, choices, s);
+        rows.cur.swap(rows.next);
+    }
+
+    // the row is nonincreasing and its last cell (all cheapest) fits
+    const int x = int(std::partition_point(rows.cur.begin(), rows.cur.end(),
+        [&](int energy) { return energy > plan.bandEnergy; }) - rows.cur.begin());
+    std::vector<int> entry(frontierSize.size(), 0);
+    mptWalkBack(dual, stages, choices, 0, nStages - 1, x, entry);
+    choice.resize(nStages);
+    for (int s = 0; s < nStages; s++) {
+        choice[s] = entry[stages.stageJob[s]];
+    }
+    lowerBound = lowTime + scale * x - (long long)nStages * (scale - 1);
+    return true;
+}
+
+template<class Jobs>
+MptAnytimeResult mptMinProcessingTimeAnytime(const Jobs& jobs, int nJobs, int maxEnergy,
+    std::chrono::steady_clock::time_point at)
+{
+    const MptDeadline deadline{ true, at };
+    MptAnytimeResult result;
+    if (nJobs == 0) {
+        result.answer = result.lowerBound = 0;
+        result.exact = true;
+        return result;
+    }
+    MptPlan plan;
+    if (maxEnergy >= 0) {
+        mptBuildPlan(jobs, maxEnergy, plan);
+    }
+    if (maxEnergy < 0 || !plan.feasible) {
+        result.exact = true;
+        return result;
+    }
+
+    MptStages stages;
+    stages.Build(plan);
+    const int nStages = stages.Count();
+
+    auto accept = [&](const std::vector<int>& choice) {
+        long long time = 0;
+        for (int s = 0; s < nStages; s++) {
+            time += plan.groups[stages.stageGroup[s]].frontier[choice[s]].time;
+        }
+        if (time < result.answer) {
+            result.answer = int(time);
+            result.assignment.assign(nJobs, -1);
+            for (int s = 0; s < nStages; s++) {
+                const int job = stages.stageJob[s];
+                result.assignment[job] = plan.coreOf[plan.coreOffset[job] + choice[s]];
+            }
+        }
+    };
+
+    std::vector<int> choice;
+    long long greedyTime = 0;
+    long long bound = 0;
+    mptGreedySchedule(plan, stages, choice, greedyTime, bound);
+    accept(choice);
+    result.lowerBound = int(bound);
+
+    // refine with finer and finer time scales while the choice table fits,
+    // up to the exact dual
+    long long lowTime = 0;
+    const long long timeBand = mptTimeBand(plan, lowTime);
+    long long targetCells = 4096;
+    long long lastScale = 0;
+    while (result.answer > result.lowerBound && lastScale != 1) {
+        const long long scale = std::max(1LL, (timeBand + targetCells - 1) / targetCells);
+        targetCells *= 8;
+        if (scale == lastScale) {
+            continue;
+        }
+        lastScale = scale;
+        if (!mptScaledDualRound(plan, stages, scale, deadline, choice, bound)) {
+            break;
+        }
+        result.rounds++;
+        accept(choice);
+        result.lowerBound = std::max(result.lowerBound, int(std::min<long long>(bound, result.answer)));
+    }
+
+    // then the exact primal DP; its forward pass alone already proves the bound
+    if (result.answer > result.lowerBound && !deadline.Passed()) {
+        std::vector<int> assignment(nJobs, -1);
+        const int optimum = mptAssign(plan, stages, MptAssignmentMode::Auto, assignment, deadline);
+        if (optimum >= 0) {
+            result.rounds++;
+            result.lowerBound = optimum;
+            if (!assignment.empty()) {
+                result.answer = optimum;
+                result.assignment.swap(assignment);
+            }
+        }
+    }
+    result.exact = (result.answer == result.lowerBound);
+    return result;
+}
+
+// MinProcessingTime under a deadline. A greedy schedule and an LP lower
+// bound are available at once; scaled dual DPs then tighten both until the
+// deadline passes or the answer is proven optimal.
+MptAnytimeResult MinProcessingTimeAnytime(const std::vector<std::vector<Profile>>& profiles,
+    int maxEnergy, std::chrono::steady_clock::time_point deadline)
+{
+    return mptMinProcessingTimeAnytime(profiles, int(profiles.size()), maxEnergy, deadline);
+}
+
+MptAnytimeResult MinProcessingTimeAnytime(const MptProfileTable& table, int maxEnergy,
+    std::chrono::steady_clock::time_point deadline)
+{
+    return mptMinProcessingTimeAnytime(table, table.nJobs, maxEnergy, deadline);
+}
+
+// Profile of a core under two budgets: energy and a second resource such as
+// memory or heat
+struct MptResourceProfile
+{
+    int time {0};
+    int energy {0};
+    int resource {0};
+};
+
+enum class MptResourceMode
+{
+    Exact,        // Pareto sets over (energy, resource)
+    Lagrangian    // second budget priced into the time, on the energy engine
+};
+
+struct MptResourceResult
+{
+    int answer {mptInfinity};        // time of the best schedule found
+    int lowerBound {mptInfinity};
+    std::vector<int> assignment;     // core of every job in that schedule
+    bool exact {false};
+};
+
+// Partial schedule of the exact multi-resource engine
+struct MptResourceState
+{
+    int time;
+    int energy;
+    int resource;
+    int parent;     // state of the previous stage
+    int core;       // profile of this stage's job
+};
+
+// Keeps the states that no other state beats in time, energy and resource.
+// In order of energy, then resource, then time, a state survives iff it is
+// faster than every kept state that uses no more resource; those kept
+// (resource, time) pairs form a staircase with times falling as resource
+// grows, so one lookup answers that.
+void mptPruneDominated(std::vector<MptResourceState>& states, std::map<int, int>& staircase)
+{
+    std::sort(states.begin(), states.end(), [](const MptResourceState& a, const MptResourceState& b) {
+        return (a.energy < b.energy) ||
+            (a.energy == b.energy && (a.resource < b.resource ||
+            (a.resource == b.resource && a.time < b.time)));
+    });
+
+    staircase.clear();
+    size_t nKept = 0;
+    for (size_t i = 0; i < states.size(); i++) {
+        const MptResourceState& state = states[i];
+        auto it = staircase.upper_bound(state.resource);
+        if (it != staircase.begin() && std::prev(it)->second <= state.time) {
+            continue;
+        }
+        it = staircase.lower_bound(state.resource);
+        while (it != staircase.end() && it->second >= state.time) {
+            it = staircase.erase(it);
+        }
+        staircase.emplace_hint(it, state.resource, state.time);
+        states[nKept++] = state;
+    }
+    states.resize(nKept);
+}
+
+// Multiplier of the best Lagrangian bound: the resource costs
+// multiplier / scale units of time
+struct MptResourcePrice
+{
+    long long multiplier {0};
+    long long scale {1};
+};
+
+// Lagrangian relaxation of the second budget. For a multiplier p / scale
+// the resource is priced into the time, time' = scale * time + p * resource,
+// and the energy-only engine finds the schedule S_p minimizing the total
+// time' W_p. Every p proves optimum >= (W_p - p * maxResource) / scale, and
+// S_p is a feasible answer when it fits in maxResource. The resource of S_p
+// falls as p grows, so p is bisected for the smallest fitting multiplier.
+// A multiplier above scale * (total time) ranks schedules by resource
+// first, so if even that schedule does not fit, none does.
+MptResourceResult mptResourceLagrangian(const std::vector<std::vector<MptResourceProfile>>& profiles,
+    int maxEnergy, int maxResource, MptResourcePrice* price = nullptr)
+{
+    MptResourceResult result;
+    const int nJobs = int(profiles.size());
+
+    // profiles that alone exceed the second budget can never be used
+    std::vector<std::vector<int>> usable(nJobs);
+    long long totalTime = 0;
+    long long totalResource = 0;
+    for (int i = 0; i < nJobs; i++) {
+        int slowest = 0;
+        int hungriest = 0;
+        for (int k = 0; k < int(profiles[i].size()); k++) {
+            if (profiles[i][k].resource <= maxResource) {
+                usable[i].push_back(k);
+                slowest = std::max(slowest, profiles[i][k].time);
+                hungriest = std::max(hungriest, profiles[i][k].resource);
+            }
+        }
+        if (usable[i].empty()) {
+            result.exact = true;
+            return result;
+        }
+        totalTime += slowest;
+        totalResource += hungriest;
+    }
+
+    // finest multiplier grid that keeps every time' total below mptInfinity
+    long long scale = 256;
+    while (scale > 1 && scale * totalTime + (scale * totalTime + 1) * totalResource >= mptInfinity) {
+        scale /= 2;
+    }
+    const long long maxMultiplier = (totalResource == 0) ? 0 :
+        std::min(scale * totalTime + 1, (mptInfinity - 1 - scale * totalTime) / totalResource);
+    if (maxMultiplier < 0) {
+        result.lowerBound = 0;    // times alone overflow the engine
+        return result;
+    }
+
+    std::vector<std::vector<Profile>> priced(nJobs);
+    std::vector<int> chosen;
+    std::vector<int> assignment;
+    long long bound = 0;
+    auto evaluate = [&](long long multiplier, bool& fits) {
+        for (int i = 0; i < nJobs; i++) {
+            priced[i].clear();
+            for (int k : usable[i]) {
+                priced[i].push_back(Profile{ int(scale * profiles[i][k].time +
+                    multiplier * profiles[i][k].resource), profiles[i][k].energy });
+            }
+        }
+        const int weight = MinProcessingTime(priced, maxEnergy, chosen);
+        if (weight >= mptInfinity) {
+            return false;
+        }
+        long long time = 0;
+        long long resource = 0;
+        for (int i = 0; i < nJobs; i++) {
+            time += profiles[i][usable[i][chosen[i]]].time;
+            resource += profiles[i][usable[i][chosen[i]]].resource;
+        }
+        const long long relaxed = (weight - multiplier * maxResource + scale - 1) / scale;
+        if (relaxed > bound) {
+            bound = relaxed;
+            if (price != nullptr) {
+                *price = MptResourcePrice{ multiplier, scale };
+            }
+        }
+        fits = (resource <= maxResource);
+        if (fits && time < result.answer) {
+            result.answer = int(time);
+            result.assignment.resize(nJobs);
+            for (int i = 0; i < nJobs; i++) {
+                result.assignment[i] = usable[i][chosen[i]];
+            }
+        }
+        return true;
+    };
+
+    bool fits = false;
+    if (!evaluate(0, fits)) {
+        result.exact = true;    // the energy budget alone is infeasible
+        return result;
+    }
+    if (!fits) {
+        long long low = 0;
+        long long high = maxMultiplier;
+        evaluate(high, fits);
+        if (!fits) {
+            result.exact = (high > scale * totalTime);
+            result.lowerBound = result.exact ? mptInfinity : int(bound);
+            return result;
+        }
+        while (high - low > 1) {
+            const long long mid = low + (high - low) / 2;
+            evaluate(mid, fits);
+            if (fits) {
+                high = mid;
+            }
+            else {
+                low = mid;
+            }
+        }
+    }
+    result.lowerBound = int(std::min<long long>(bound, result.answer));
+    result.exact = (result.answer == result.lowerBound);
+    return result;
+}
+
+// Minimum total weightOf of jobs i..n-1 for every budget 0..budget of one
+// resource, ignoring the other: rows[i][x]. Empty if the table does not
+// fit in the dense memory budget.
+template<class WeightOf, class ResourceOf>
+void mptSuffixRows(const std::vector<std::vector<MptResourceProfile>>& profiles, int budget,
+    WeightOf weightOf, ResourceOf resourceOf, std::vector<std::vector<int>>& rows)
+{
+    const int nJobs = int(profiles.size());
+    rows.clear();
+    if (double(nJobs + 1) * (double(budget) + 1) * sizeof(int) > double(mptConfig().denseMemoryBudget)) {
+        return;
+    }
+    rows.assign(nJobs + 1, std::vector<int>());
+    rows[nJobs].assign(size_t(budget) + 1, 0);
+    std::vector<Profile> job;
+    for (int i = nJobs - 1; i >= 0; i--) {
+        job.clear();
+        for (const MptResourceProfile& core : profiles[i]) {
+            job.push_back(Profile{ weightOf(core), resourceOf(core) });
+        }
+        rows[i].resize(size_t(budget) + 1);
+        mptTransition(rows[i + 1].data(), rows[i].data(), budget, job);
+    }
+}
+
+// Exact engine: the sparse engine's Pareto lists extended to a resource
+// vector, kept per stage for the walk back. The Lagrangian schedule is the
+// incumbent: a partial schedule is dropped when its time plus a lower
+// bound for the remaining jobs cannot beat it. The bound is the best of
+// the fastest they can run within the energy left, within the resource
+// left, and the Lagrangian bound of the remaining jobs at the best
+// multiplier.
+MptResourceResult mptResourceExact(const std::vector<std::vector<MptResourceProfile>>& profiles,
+    int maxEnergy, int maxResource)
+{
+    MptResourcePrice price;
+    MptResourceResult result = mptResourceLagrangian(profiles, maxEnergy, maxResource, &price);
+    if (result.exact) {
+        return result;
+    }
+
+    const int nJobs = int(profiles.size());
+    auto timeOf = [](const MptResourceProfile& core) { return core.time; };
+    auto energyOf = [](const MptResourceProfile& core) { return core.energy; };
+    auto resourceOf = [](const MptResourceProfile& core) { return core.resource; };
+    auto pricedOf = [&](const MptResourceProfile& core) {
+        // resources above the budget never fit; any weight will do
+        return int(std::min<long long>(price.scale * core.time + price.multiplier * core.resource,
+            mptInfinity));
+    };
+    std::vector<std::vector<int>> energyRows;
+    std::vector<std::vector<int>> resourceRows;
+    std::vector<std::vector<int>> pricedRows;
+    mptSuffixRows(profiles, maxEnergy, timeOf, energyOf, energyRows);
+    mptSuffixRows(profiles, maxResource, timeOf, resourceOf, resourceRows);
+    if (price.multiplier > 0) {
+        mptSuffixRows(profiles, maxEnergy, pricedOf, energyOf, pricedRows);
+    }
+    auto promising = [&](int stage, const MptResourceState& state) {
+        long long rest = 0;
+        if (!energyRows.empty()) {
+            rest = energyRows[stage][maxEnergy - state.energy];
+        }
+        if (!resourceRows.empty()) {
+            rest = std::max<long long>(rest, resourceRows[stage][maxResource - state.resource]);
+        }
+        if (!pricedRows.empty()) {
+            const long long relaxed = pricedRows[stage][maxEnergy - state.energy] -
+                price.multiplier * (maxResource - state.resource);
+            rest = std::max(rest, (relaxed + price.scale - 1) / price.scale);
+        }
+        return state.time + rest < result.answer;
+    };
 
+    std::vector<std::vector<MptResourceState>> stages(nJobs + 1);
+    stages[0].push_back(MptResourceState{ 0, 0, 0, -1, -1 });
+    std::vector<MptResourceState> job;
+    std::map<int, int> staircase;
+
+    for (int i = 0; i < nJobs; i++) {
+        job.clear();
+        for (int k = 0; k < int(profiles[i].size()); k++) {
+            const MptResourceProfile& core = profiles[i][k];
+            job.push_back(MptResourceState{ core.time, core.energy, core.resource, -1, k });
+        }
+        mptPruneDominated(job, staircase);
+
+        const std::vector<MptResourceState>& cur = stages[i];
+        std::vector<MptResourceState>& next = stages[i + 1];
+        for (int p = 0; p < int(cur.size()); p++) {
+            for (const MptResourceState& core : job) {
+                const long long energy = (long long)cur[p].energy + core.energy;
+                const long long resource = (long long)cur[p].resource + core.resource;
+                if (energy > maxEnergy || resource > maxResource) {
+                    continue;
+                }
+                MptResourceState state{ mptSaturatingAdd(cur[p].time, core.time),
+                    int(energy), int(resource), p, core.core };
+                if (promising(i + 1, state)) {
+                    next.push_back(state);
+                }
+            }
+        }
+        mptPruneDominated(next, staircase);
+        if (next.empty()) {
+            break;
+        }
+    }
+
+    // without a surviving state, nothing beats the incumbent (or nothing fits)
+    const std::vector<MptResourceState>& last = stages[nJobs];
+    result.exact = true;
+    if (last.empty()) {
+        result.lowerBound = result.answer;
+        return result;
+    }
+    int best = 0;
+    for (int p = 1; p < int(last.size()); p++) {
+        best = (last[p].time < last[best].time) ? p : best;
+    }
+    result.answer = result.lowerBound = last[best].time;
+    result.assignment.assign(nJobs, -1);
+    for (int i = nJobs; i > 0; i--) {
+        result.assignment[i - 1] = stages[i][best].core;
+        best = stages[i][best].parent;
+    }
+    return result;
+}
+
+// MinProcessingTime with a second budget: every job runs on one core, the
+// energies add up to at most maxEnergy and the resources to at most
+// maxResource. The exact mode returns the optimum; the Lagrangian mode is
+// much faster on large instances and returns a feasible schedule with a
+// lower bound (exact tells whether they meet); the exact mode starts from
+// it.
+MptResourceResult MinProcessingTimeMultiResource(
+    const std::vector<std::vector<MptResourceProfile>>& profiles, int maxEnergy, int maxResource,
+    MptResourceMode mode = MptResourceMode::Exact)
+{
+    if (profiles.empty()) {
+        MptResourceResult result;
+        result.answer = result.lowerBound = 0;
+        result.exact = true;
+        return result;
+    }
+    if (maxEnergy < 0 || maxResource < 0) {
+        MptResourceResult result;
+        result.exact = true;
+        return result;
+    }
+    return (mode == MptResourceMode::Exact) ?
+        mptResourceExact(profiles, maxEnergy, maxResource) :
+        mptResourceLagrangian(profiles, maxEnergy, maxResource);
 }
@@ -8,19 +8,47 @@
 #define _test_framework_h_
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <chrono>
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define TEST_FRAMEWORK_MMAP 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TEST_FRAMEWORK_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace TestFramework
 {
    constexpr int GetTestFrameworkVersion ()
@@ -51,10 +79,66 @@ namespace TestFramework
       }
    }
 
+   // Removes every occurrence of the flag from the command line and reports
+   // whether it was there, so that positional arguments keep their indices
+   bool ExtractFlag(int& argc, char* argv[], const char* flag)
+   {
+      bool isFound = false;
+      int nArgs = 0;
+
+      for (int i = 0; i < argc; i++)
+      {
+         if ((i > 0) && (strcmp(argv[i], flag) == 0))
+         {
+            isFound = true;
+         }
+         else
+         {
+            argv[nArgs++] = argv[i];
+         }
+      }
+
+      argc = nArgs;
+      return isFound;
+   }
+
+   // Number of solver threads: --threads=N on the command line (removed from
+   // it), otherwise the TEST_FRAMEWORK_THREADS environment variable. Zero, or
+   // neither being set, means one thread per hardware thread.
+   size_t ExtractThreadCount(int& argc, char* argv[])
+   {
+      const char* prefix = "--threads=";
+      const size_t prefixLength = strlen(prefix);
+      const char* value = getenv("TEST_FRAMEWORK_THREADS");
+
+      int nArgs = 0;
+      for (int i = 0; i < argc; i++)
+      {
+         if ((i > 0) && (strncmp(argv[i], prefix, prefixLength) == 0))
+         {
+            value = argv[i] + prefixLength;
+         }
+         else
+         {
+            argv[nArgs++] = argv[i];
+         }
+      }
+      argc = nArgs;
+
+      if ((value == nullptr) || (*value == 0)) return 0;
+
+      char* pEnd = nullptr;
+      long nThreads = strtol(value, &pEnd, 10);
+      ExitIfConditionFails((*pEnd == 0) && (nThreads >= 0) && (nThreads <= 1024), "Invalid thread count.");
+
+      return static_cast<size_t>(nThreads);
+   }
+
    class StringSegment
    {
    public:
       StringSegment(const std::string& s);
+      StringSegment(const char* begin, size_t length);
 
       void CopyTo(std::string& dest) const;
       bool CopyTo(char* buffer, size_t buffer_size) const;
@@ -69,6 +153,8 @@ namespace TestFramework
       char ReadRight();
 
       char FirstChar() const;
+      const char* Begin() const;
+      const char* End() const;
       char LastChar() const;
 
       void RemovePrefix(size_t count);
@@ -88,7 +174,32 @@ namespace TestFramework
    private:
       size_t iBegin;
       size_t iEnd;
-      const std::string& str;
+      const char* str;
+   };
+
+   // Read-only view of a whole file. The file is memory-mapped where the
+   // platform supports it, and read into a single buffer otherwise.
+   class MappedFile
+   {
+   public:
+      MappedFile();
+      ~MappedFile();
+
+      bool Open(const char* filename);
+      void Close();
+
+      const char* Data() const;
+      size_t Size() const;
+
+   private:
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator =(const MappedFile&) = delete;
+
+   private:
+      const char* pData;
+      size_t size;
+      bool isMapped;
+      std::string buffer;
    };
 
    class AbstractLineParser
@@ -96,6 +207,8 @@ namespace TestFramework
    public:
       AbstractLineParser();
       void ParseFile(const char* filename, bool shouldExitOnError = false);
+      void ParseBuffer(const char* data, size_t size, bool shouldExitOnError = false);
+      void ParseStream(std::istream& input, bool shouldExitOnError = false);
       bool IsOK() const;
 
    protected:
@@ -106,15 +219,37 @@ namespace TestFramework
       virtual void PostParse() {};
       virtual void ParseLine(StringSegment s) = 0;
 
-   private:
+   protected:
       void ClearErrors();
 
+   private:
+      void ParseLines(const char* data, size_t size);
+      size_t ParseBlock(const char* data, size_t size, bool isLastBlock);
+
    private:
       size_t lineNumber;
       bool bExitOnError;
       bool isOK;
    };
 
+   // One column of the binary problem set cache. Scalar columns hold one
+   // value per row; list columns hold row i in values[offsets[i], offsets[i + 1]).
+   struct BinaryColumn
+   {
+      bool isList = false;
+      std::vector<uint32_t> offsets;
+      std::vector<int32_t> values;
+   };
+
+   // The same column inside a mapped cache file
+   struct BinaryColumnView
+   {
+      bool isList = false;
+      const uint32_t* offsets = nullptr;
+      const int32_t* values = nullptr;
+      size_t valueCount = 0;
+   };
+
    template<class T>
    class BaseFieldAdapter
    {
@@ -124,6 +259,9 @@ namespace TestFramework
 
       virtual void ToString(const T& var, std::string& s /* out */) const = 0;
 
+      virtual void ToBinary(const T& var, BinaryColumn& column) const = 0;
+      virtual bool FromBinary(T& var, const BinaryColumnView& column, size_t row) const = 0;
+
       virtual bool EqualsDefaultValue(const T& var) const = 0;
       virtual void SetDefaultValue(T& var) const = 0;
 
@@ -141,6 +279,9 @@ namespace TestFramework
       bool FromString(T& var, StringSegment s) const override;
       void ToString(const T& var, std::string& s /* out */) const override;
 
+      void ToBinary(const T& var, BinaryColumn& column) const override;
+      bool FromBinary(T& var, const BinaryColumnView& column, size_t row) const override;
+
       bool EqualsDefaultValue(const T& var) const override;
       void SetDefaultValue(T& var) const override;
 
@@ -171,6 +312,17 @@ namespace TestFramework
       virtual size_t ColumnCount() const = 0;
       virtual size_t RowCount() const = 0;
 
+      // Shards are empty tables with the same columns that can be filled
+      // independently and then appended back in order. Tables that do not
+      // support sharding return nullptr.
+      virtual std::unique_ptr<ITable> NewShard() const;
+      virtual bool MergeShard(ITable& shard);
+
+      // Whole columns in the binary cache format. Tables that do not
+      // support it return false.
+      virtual bool GetColumn(size_t col, BinaryColumn& column) const;
+      virtual bool SetColumn(size_t col, const BinaryColumnView& column);
+
       virtual ~ITable() {}
    };
 
@@ -194,6 +346,9 @@ namespace TestFramework
 
       size_t ColumnCount() const override;
 
+      bool GetColumn(size_t col, BinaryColumn& column) const override;
+      bool SetColumn(size_t col, const BinaryColumnView& column) override;
+
       virtual ~AbstractTableAdapter(){};
    private:
       virtual T& GetRecord(size_t i) = 0;
@@ -240,16 +395,229 @@ namespace TestFramework
 
    public:
       TableAdapter(std::vector<T>& data) : data(data) {};
+      TableAdapter(std::vector<T>& data, const AbstractTableAdapter<T>& columns);
 
       bool NewRow(size_t& row) override;
       bool IsFixedSize() const override;
       size_t RowCount() const override;
 
+      std::unique_ptr<ITable> NewShard() const override;
+      bool MergeShard(ITable& shard) override;
+
    private:
+      TableAdapter() : data(shardData) {};
+
       T & GetRecord(size_t i) override;
       const T& GetRecord(size_t i) const override;
 
    private:
+      std::vector<T> shardData;
+      std::vector<T>& data;
+   };
+
+   ///////////////////////////////////////////////////////////////////////////////
+   // Compile-time schemas
+   //
+   // A schema is a class with a constexpr function that returns a tuple of
+   // fields, e.g.
+   //
+   //    struct ProblemSchema
+   //    {
+   //       static constexpr auto Fields()
+   //       {
+   //          return std::tuple_cat(DefaultProblemFields<Problem>(), std::make_tuple(
+   //                    MakeField<Problem, int>("fee", &Problem::fee, 0)));
+   //       }
+   //    };
+   //
+   // StaticTableAdapter<Problem, ProblemSchema> finds columns with a perfect
+   // hash built at compile time and reads and writes fields directly, without
+   // the virtual field adapters that AddColumn creates.
+
+   // Scalar fields carry a default value, class fields default to C()
+   template<class T, class C, bool isScalar = std::is_arithmetic<C>::value>
+   struct SchemaField
+   {
+      const char* name;
+      C T::*field_pointer;
+      C defaultValue;
+
+      C GetDefaultValue() const { return defaultValue; }
+   };
+
+   template<class T, class C>
+   struct SchemaField<T, C, false>
+   {
+      const char* name;
+      C T::*field_pointer;
+
+      C GetDefaultValue() const { return C(); }
+   };
+
+   template<class T, class C>
+   constexpr typename std::enable_if<std::is_arithmetic<C>::value, SchemaField<T, C>>::type
+   MakeField(const char* name, C T::*field_pointer, C defaultValue = C())
+   {
+      return SchemaField<T, C>{ name, field_pointer, defaultValue };
+   }
+
+   template<class T, class C>
+   constexpr typename std::enable_if<!std::is_arithmetic<C>::value, SchemaField<T, C>>::type
+   MakeField(const char* name, C T::*field_pointer)
+   {
+      return SchemaField<T, C>{ name, field_pointer };
+   }
+
+   constexpr char SchemaToLower(char c)
+   {
+      return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c;
+   }
+
+   constexpr size_t SchemaNameLength(const char* name)
+   {
+      size_t length = 0;
+      while (name[length] != 0) length++;
+      return length;
+   }
+
+   // Case-insensitive, like column names
+   constexpr uint32_t SchemaHash(const char* key, size_t length, uint32_t seed)
+   {
+      uint32_t hash = 2166136261u ^ seed;
+
+      for (size_t i = 0; i < length; i++)
+      {
+         hash ^= static_cast<unsigned char>(SchemaToLower(key[i]));
+         hash *= 16777619u;
+      }
+
+      return hash ^ (hash >> 16);
+   }
+
+   constexpr size_t SchemaSlotCount(size_t nFields)
+   {
+      size_t nSlots = 2;
+      while (nSlots < 2 * nFields) nSlots *= 2;
+      return nSlots;
+   }
+
+   template<size_t nSlots>
+   struct SchemaIndex
+   {
+      uint32_t seed;
+      bool isPerfect;
+      unsigned char slots[nSlots]; // field index + 1, or 0 for an empty slot
+   };
+
+   // Tries seeds until every name gets its own slot
+   template<size_t nSlots, size_t nFields>
+   constexpr SchemaIndex<nSlots> BuildSchemaIndex(const char* const (&names)[nFields])
+   {
+      SchemaIndex<nSlots> index{};
+
+      for (uint32_t seed = 0; seed < 4096; seed++)
+      {
+         for (size_t slot = 0; slot < nSlots; slot++) index.slots[slot] = 0;
+
+         bool bCollision = false;
+         for (size_t i = 0; (i < nFields) && !bCollision; i++)
+         {
+            size_t slot = SchemaHash(names[i], SchemaNameLength(names[i]), seed) & (nSlots - 1);
+            bCollision = (index.slots[slot] != 0);
+            index.slots[slot] = static_cast<unsigned char>(i + 1);
+         }
+
+         if (!bCollision)
+         {
+            index.seed = seed;
+            index.isPerfect = true;
+            return index;
+         }
+      }
+
+      index.isPerfect = false;
+      return index;
+   }
+
+   template<size_t nSlots, class Fields, size_t... I>
+   constexpr SchemaIndex<nSlots> BuildSchemaIndex(const Fields& fields, std::index_sequence<I...>)
+   {
+      const char* const names[] = { std::get<I>(fields).name... };
+      return BuildSchemaIndex<nSlots>(names);
+   }
+
+   // Calls visitor(field) for the field with the given index
+   template<size_t I, class Fields, class Visitor>
+   typename std::enable_if<(I == std::tuple_size<Fields>::value), bool>::type
+   VisitSchemaField(const Fields& /* fields */, size_t /* index */, Visitor& /* visitor */)
+   {
+      return false;
+   }
+
+   template<size_t I = 0, class Fields, class Visitor>
+   typename std::enable_if<(I < std::tuple_size<Fields>::value), bool>::type
+   VisitSchemaField(const Fields& fields, size_t index, Visitor& visitor)
+   {
+      if (index == I) return visitor(std::get<I>(fields));
+      return VisitSchemaField<I + 1>(fields, index, visitor);
+   }
+
+   template<class T>
+   constexpr auto DefaultProblemFields()
+   {
+      return std::make_tuple(MakeField<T, int>("problem", &T::id, -1),
+                             MakeField<T, int>("correct_answer", &T::correct_answer, -1));
+   }
+
+   template<class T, class Schema>
+   class StaticTableAdapter final : public ITable
+   {
+   public:
+      typedef T DataType;
+
+   public:
+      StaticTableAdapter(std::vector<T>& data);
+
+      bool NewRow(size_t& row) override;
+      void SetDefaultValues(size_t row) override;
+      bool IsFixedSize() const override;
+
+      const std::string& GetColumnName(size_t col) const override;
+
+      using ITable::GetValue;
+      bool GetValue(size_t row, size_t col, std::string& value) const override;
+      bool SetValue(size_t row, size_t col, StringSegment value) override;
+      bool SetValue(size_t row, StringSegment key, StringSegment value) override;
+
+      bool GetColumnByName(StringSegment key, size_t& col) const override;
+
+      bool EqualsDefaultValue(size_t row, size_t col) const override;
+
+      size_t ColumnCount() const override;
+      size_t RowCount() const override;
+
+      std::unique_ptr<ITable> NewShard() const override;
+      bool MergeShard(ITable& shard) override;
+
+      bool GetColumn(size_t col, BinaryColumn& column) const override;
+      bool SetColumn(size_t col, const BinaryColumnView& column) override;
+
+   private:
+      typedef decltype(Schema::Fields()) Fields;
+      static constexpr size_t fieldCount = std::tuple_size<Fields>::value;
+      typedef SchemaIndex<SchemaSlotCount(fieldCount)> Index;
+
+      static_assert(fieldCount > 0, "A schema needs at least one field.");
+      static_assert(fieldCount < 256, "A schema has at most 255 fields.");
+
+   private:
+      StaticTableAdapter() : StaticTableAdapter(shardData) {};
+
+      static const Index& GetIndex();
+
+   private:
+      std::vector<std::string> names;
+      std::vector<T> shardData;
       std::vector<T>& data;
    };
 
@@ -266,12 +634,84 @@ namespace TestFramework
       void SetTableAdapter(ITable* newAdapter);
 
       void PreParse() override;
+      void PostParse() override;
       void ParseLine(StringSegment s) override;
 
+      // Parses the data section in shards of whole records, one thread per
+      // shard, and appends the shards to the table in file order. Falls back
+      // to ParseFile when the table cannot be sharded or a shard fails.
+      void ParseFileParallel(const char* filename, bool shouldExitOnError = false,
+                             size_t threadCount = 0);
+      void ParseBufferParallel(const char* data, size_t size, bool shouldExitOnError = false,
+                               size_t threadCount = 0);
+
+      // Loads the tables from the binary sidecar "<filename>.cache" when it
+      // was written for the same file contents, and parses the file and
+      // writes the sidecar otherwise. The sidecar is mapped and every column
+      // is decoded straight from the mapping into the problem fields: the
+      // solvers take std::vector<int>, so they cannot be handed views into
+      // the mapping, but nothing is parsed from text.
+      void ParseFileCached(const char* filename, bool shouldExitOnError = false,
+                           size_t threadCount = 0);
+
+      // Reads the file in blocks and calls onRecord(row) as soon as a record
+      // is complete, before the next one is read. The handler may clear the
+      // table, so only the current record has to be kept in memory.
+      void ParseFileStreaming(const char* filename, std::function<void(size_t)> onRecord,
+                              bool shouldExitOnError = false);
+
+   private:
+      static const char* FindDataSection(const char* pBegin, const char* pEnd);
+      static const char* FindRecordStart(const char* pBegin, const char* pEnd);
+
    private:
       ITable* pHeader;
       ITable* pTable;
       bool isHeaderSection;
+      bool isDataShard = false;
+      std::function<void(size_t)> recordHandler;
+   };
+
+   // Identifies the contents of an input file for the binary cache
+   struct SourceFileKey
+   {
+      uint64_t size = 0;
+      int64_t mtime = 0;
+      uint64_t hash = 0;
+   };
+
+   bool GetSourceFileKey(const char* filename, const MappedFile& contents, SourceFileKey& key);
+   bool SaveTableCache(const char* cacheFilename, const SourceFileKey& key,
+                       const ITable* header, const ITable* table);
+   bool LoadTableCache(const char* cacheFilename, const SourceFileKey& key,
+                       ITable* header, ITable* table);
+
+   // Histogram of latencies in nanoseconds in the spirit of HdrHistogram:
+   // values below 64 get a bucket each, and every larger power of two is
+   // split into 32 linear sub-buckets, so a percentile is exact to within
+   // about 3% with a fixed set of counters and no per-value storage.
+   class LatencyHistogram
+   {
+   public:
+      LatencyHistogram();
+
+      void Record(int64_t value);
+
+      size_t Count() const { return totalCount; }
+      int64_t Max() const { return maxValue; }
+      int64_t ValueAtPercentile(double percentile) const;
+
+   private:
+      static constexpr int subBucketBits = 5;
+      static constexpr uint64_t subBucketCount = 1u << subBucketBits;
+
+      static size_t BucketIndex(uint64_t value);
+      static uint64_t BucketHighestValue(size_t index);
+
+   private:
+      std::vector<uint64_t> counts;
+      size_t totalCount;
+      int64_t maxValue;
    };
 
    struct ProblemSetHeader
@@ -280,8 +720,15 @@ namespace TestFramework
       int problem_count = 0;
       int test_mistakes = -1;
       int time = -1;
+      int64_t latency_p50 = -1;   // nanoseconds per problem
+      int64_t latency_p90 = -1;
+      int64_t latency_p99 = -1;
+      int64_t latency_max = -1;
       std::string student_name;
       std::chrono::high_resolution_clock::time_point tStart;
+
+      LatencyHistogram latency;
+      int slowest_problem = -1;
    };
 
    struct BasicProblem
@@ -289,6 +736,8 @@ namespace TestFramework
       int id;
       int correct_answer;
       int student_answer;
+      int input_size = -1;        // n, set by the solver
+      int64_t solve_time = -1;    // nanoseconds
    };
 
    ///////////////////////////////////////////////////////////////////////////////
@@ -356,6 +805,11 @@ namespace TestFramework
       IntToStrHelper(value, result);
    }
 
+   void Encode(int64_t value, std::string& result)
+   {
+      result = std::to_string(value);
+   }
+
    void Encode(bool value, std::string& result)
    {
       result.assign(value ? "yes" : "no");
@@ -403,22 +857,23 @@ namespace TestFramework
    }
 
    // Parse integer values
-   bool Parse(StringSegment segment, int& result)
+   template<class I>
+   bool ParseInteger(StringSegment segment, I& result)
    {
       // if x < posOverflowGuard,  then we can append any digit to x without
       // integer overflow.
       // if x == posOverflowGuard, then we can append only some digits
       // if x > posOverflowGuard,  then we can not append any digits
-      static constexpr int posOverflowGuard = std::numeric_limits<int>::max() / 10;
-      static constexpr int posLastDigitGuard = std::numeric_limits<int>::max() % 10;
+      static constexpr I posOverflowGuard = std::numeric_limits<I>::max() / 10;
+      static constexpr I posLastDigitGuard = std::numeric_limits<I>::max() % 10;
 
       // Similar thersholds for negative numbers
       // Note: Staring with C++11, the remainder of a negative number is negative.
       // For example, -7/3 = -2 and -7 % 3 = -1. See e.g. for details:
       // https://en.cppreference.com/w/cpp/language/operator_arithmetic#Multiplicative_operators
 
-      static constexpr int negOverflowGuard = std::numeric_limits<int>::min() / 10;
-      static constexpr int negLastDigitGuard = std::numeric_limits<int>::min() % 10;
+      static constexpr I negOverflowGuard = std::numeric_limits<I>::min() / 10;
+      static constexpr I negLastDigitGuard = std::numeric_limits<I>::min() % 10;
 
       result = 0;
       segment.Trim();
@@ -453,6 +908,16 @@ namespace TestFramework
       return true;
    }
 
+   bool Parse(StringSegment segment, int& result)
+   {
+      return ParseInteger(segment, result);
+   }
+
+   bool Parse(StringSegment segment, int64_t& result)
+   {
+      return ParseInteger(segment, result);
+   }
+
    bool Parse(StringSegment segment, std::string& result)
    {
       segment.Trim();
@@ -481,6 +946,124 @@ namespace TestFramework
       return false;
    }
 
+   int CountTrailingZeros(unsigned mask)
+   {
+      assert(mask != 0);
+#ifdef _MSC_VER
+      unsigned long index = 0;
+      _BitScanForward(&index, mask);
+      return static_cast<int>(index);
+#else
+      return __builtin_ctz(mask);
+#endif
+   }
+
+   // Fast path for items of at most nine digits with an optional minus sign.
+   // Nine digits cannot overflow an int, so there are no overflow checks.
+   bool ParseShortInt(const char* p, const char* pEnd, int& result)
+   {
+      int sign = 1;
+      if ((p < pEnd) && (*p == '-'))
+      {
+         sign = -1;
+         p++;
+      }
+
+      if ((p == pEnd) || (pEnd - p > 9)) return false;
+
+      int value = 0;
+      for (; p < pEnd; p++)
+      {
+         unsigned digit = static_cast<unsigned char>(*p) - '0';
+         if (digit > 9) return false;
+         value = value * 10 + static_cast<int>(digit);
+      }
+
+      result = sign * value;
+      return true;
+   }
+
+   bool AppendListItem(const char* p, const char* pEnd, std::vector<int>& result)
+   {
+      int value = 0;
+      bool bResult = ParseShortInt(p, pEnd, value);
+
+      if (!bResult)
+      {
+         //spaces, long numbers and errors
+         bResult = Parse(StringSegment(p, pEnd - p), value);
+      }
+
+      result.push_back(value);
+      return bResult;
+   }
+
+   // Parses comma-separated items exactly as splitting the list with
+   // StringSegment::Split and parsing each item would: the list ends at the
+   // first empty item, and an invalid item is appended as far as it was
+   // parsed and ends the list with an error.
+   //
+   // With SSE2, blocks of 16 characters that contain only digits and commas
+   // are split with a comma bitmask instead of character by character.
+   bool ParseIntList(const char* p, const char* pEnd, std::vector<int>& result)
+   {
+      while (p < pEnd)
+      {
+#ifdef TEST_FRAMEWORK_SSE2
+         if (pEnd - p >= 16)
+         {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+            __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+            __m128i isComma = _mm_cmpeq_epi8(block, _mm_set1_epi8(','));
+
+            unsigned commas = static_cast<unsigned>(_mm_movemask_epi8(isComma));
+            unsigned digits = static_cast<unsigned>(_mm_movemask_epi8(isDigit));
+
+            if (((commas | digits) == 0xFFFF) && (commas != 0))
+            {
+               //all items that end in this block
+               const char* pItem = p;
+               while (commas != 0)
+               {
+                  const char* pComma = p + CountTrailingZeros(commas);
+                  if (pComma == pItem) return true;
+
+                  int value = 0;
+                  if (pComma - pItem <= 9)
+                  {
+                     for (const char* q = pItem; q < pComma; q++)
+                     {
+                        value = value * 10 + (*q - '0');
+                     }
+                     result.push_back(value);
+                  }
+                  else if (!AppendListItem(pItem, pComma, result))
+                  {
+                     return false;
+                  }
+
+                  pItem = pComma + 1;
+                  commas &= commas - 1;
+               }
+
+               p = pItem;
+               continue;
+            }
+         }
+#endif
+         const char* pComma = static_cast<const char*>(memchr(p, ',', pEnd - p));
+         if (pComma == nullptr) pComma = pEnd;
+         if (pComma == p) return true;
+
+         if (!AppendListItem(p, pComma, result)) return false;
+
+         p = pComma + 1;
+      }
+
+      return true;
+   }
+
    bool Parse(StringSegment segment, std::vector<int>& result)
    {
       result.clear();
@@ -494,61 +1077,133 @@ namespace TestFramework
       size_t nCount = segment.CountChars(',') + 1;
       result.reserve(nCount);
 
-      StringSegment prefix(segment);
-
-      segment.Split(',', prefix);
-      bool noErrors = true;
-
-      while (!prefix.IsEmpty() && noErrors)
-      {
-         int nextValue = 0;
-         noErrors = noErrors && Parse(prefix, nextValue);
-         result.push_back(nextValue);
-         segment.Split(',', prefix);
-      }
-
-      return noErrors;
+      return ParseIntList(segment.Begin(), segment.End(), result);
    }
 
-   ///////////////////////////////////////////////////////////////////////////////
+   void EncodeBinary(int value, BinaryColumn& column)
+   {
+      column.values.push_back(value);
+   }
 
-   template<class T, class C>
-   std::shared_ptr<BaseFieldAdapter<T>> CreateSharedInterface(FieldAdapter<T, C>* pAdapter)
+   void EncodeBinary(bool value, BinaryColumn& column)
    {
-      std::shared_ptr<BaseFieldAdapter<T>> sharedInterface(dynamic_cast<BaseFieldAdapter<T>*>(pAdapter));
-      return sharedInterface;
+      column.values.push_back(value ? 1 : 0);
    }
 
-   template<class T, class C>
-   void AddColumn(TableAdapter<T>& tableAdapter, const char* name, C T::*field_pointer)
+   void EncodeBinaryList(const int* pBegin, const int* pEnd, BinaryColumn& column)
    {
-      static_assert(std::is_class<C>::value, "This field must be a class.");
-      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, C>(field_pointer));
-      tableAdapter.AddNamedColumn(name, newAdapter);
+      if (column.offsets.empty()) column.offsets.push_back(0);
+
+      column.isList = true;
+      column.values.insert(column.values.end(), pBegin, pEnd);
+      column.offsets.push_back(static_cast<uint32_t>(column.values.size()));
    }
 
-   template<class T, class C>
-   void AddColumn(TableAdapter<T>& tableAdapter,
-                  const char* name,
-                  C T::*field_pointer,
-                  C defaultValue)
+   //64-bit values are stored as a list of two words, low word first
+   void EncodeBinary(int64_t value, BinaryColumn& column)
    {
-      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, C>(field_pointer, defaultValue));
-      tableAdapter.AddNamedColumn(name, newAdapter);
+      uint64_t bits = static_cast<uint64_t>(value);
+      int words[2] = { static_cast<int>(static_cast<uint32_t>(bits)), static_cast<int>(static_cast<uint32_t>(bits >> 32)) };
+      EncodeBinaryList(words, words + 2, column);
    }
 
-   template<class T>
-   void AddColumn(TableAdapter<T>& tableAdapter,
-                  const char* name,
-                  int T::*field_pointer,
-                  int defaultValue = -1)
+   void EncodeBinary(const std::string& value, BinaryColumn& column)
    {
-      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, int>(field_pointer, defaultValue));
-      tableAdapter.AddNamedColumn(name, newAdapter);
+      std::vector<int> chars(value.begin(), value.end());
+      EncodeBinaryList(chars.data(), chars.data() + chars.size(), column);
    }
 
-   template<class T, class C>
-   void AddColumn(RecordAdapter<T>& recordAdapter, const char* name, C T::*field_pointer)
+   void EncodeBinary(const std::vector<int>& value, BinaryColumn& column)
+   {
+      EncodeBinaryList(value.data(), value.data() + value.size(), column);
+   }
+
+   bool DecodeBinary(const BinaryColumnView& column, size_t row, int& result)
+   {
+      if (column.isList || (row >= column.valueCount)) return false;
+
+      result = column.values[row];
+      return true;
+   }
+
+   bool DecodeBinary(const BinaryColumnView& column, size_t row, bool& result)
+   {
+      int value = 0;
+      if (!DecodeBinary(column, row, value)) return false;
+
+      result = (value != 0);
+      return true;
+   }
+
+   bool DecodeBinary(const BinaryColumnView& column, size_t row, int64_t& result)
+   {
+      if (!column.isList || (column.offsets[row + 1] - column.offsets[row] != 2)) return false;
+
+      const int32_t* pWords = column.values + column.offsets[row];
+      uint64_t bits = static_cast<uint32_t>(pWords[0]) | (static_cast<uint64_t>(static_cast<uint32_t>(pWords[1])) << 32);
+      result = static_cast<int64_t>(bits);
+      return true;
+   }
+
+   bool DecodeBinary(const BinaryColumnView& column, size_t row, std::string& result)
+   {
+      if (!column.isList) return false;
+
+      const int32_t* pBegin = column.values + column.offsets[row];
+      const int32_t* pEnd = column.values + column.offsets[row + 1];
+      result.assign(pBegin, pEnd);
+      return true;
+   }
+
+   bool DecodeBinary(const BinaryColumnView& column, size_t row, std::vector<int>& result)
+   {
+      if (!column.isList) return false;
+
+      const int32_t* pBegin = column.values + column.offsets[row];
+      const int32_t* pEnd = column.values + column.offsets[row + 1];
+      result.assign(pBegin, pEnd);
+      return true;
+   }
+
+   ///////////////////////////////////////////////////////////////////////////////
+
+   template<class T, class C>
+   std::shared_ptr<BaseFieldAdapter<T>> CreateSharedInterface(FieldAdapter<T, C>* pAdapter)
+   {
+      std::shared_ptr<BaseFieldAdapter<T>> sharedInterface(dynamic_cast<BaseFieldAdapter<T>*>(pAdapter));
+      return sharedInterface;
+   }
+
+   template<class T, class C>
+   void AddColumn(TableAdapter<T>& tableAdapter, const char* name, C T::*field_pointer)
+   {
+      static_assert(std::is_class<C>::value, "This field must be a class.");
+      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, C>(field_pointer));
+      tableAdapter.AddNamedColumn(name, newAdapter);
+   }
+
+   template<class T, class C>
+   void AddColumn(TableAdapter<T>& tableAdapter,
+                  const char* name,
+                  C T::*field_pointer,
+                  C defaultValue)
+   {
+      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, C>(field_pointer, defaultValue));
+      tableAdapter.AddNamedColumn(name, newAdapter);
+   }
+
+   template<class T>
+   void AddColumn(TableAdapter<T>& tableAdapter,
+                  const char* name,
+                  int T::*field_pointer,
+                  int defaultValue = -1)
+   {
+      auto newAdapter = CreateSharedInterface(new FieldAdapter<T, int>(field_pointer, defaultValue));
+      tableAdapter.AddNamedColumn(name, newAdapter);
+   }
+
+   template<class T, class C>
+   void AddColumn(RecordAdapter<T>& recordAdapter, const char* name, C T::*field_pointer)
    {
       static_assert(std::is_class<C>::value, "This field must be a class.");
       auto newAdapter = CreateSharedInterface(new FieldAdapter<T, C>(field_pointer));
@@ -578,6 +1233,10 @@ namespace TestFramework
       AddColumn(psAdapter, "problems", &ProblemSetHeader::problem_count, -1);
       AddColumn(psAdapter, "time", &ProblemSetHeader::time, -1);
       AddColumn(psAdapter, "test_mistakes", &ProblemSetHeader::test_mistakes, -1);
+      AddColumn(psAdapter, "latency_p50_ns", &ProblemSetHeader::latency_p50, int64_t(-1));
+      AddColumn(psAdapter, "latency_p90_ns", &ProblemSetHeader::latency_p90, int64_t(-1));
+      AddColumn(psAdapter, "latency_p99_ns", &ProblemSetHeader::latency_p99, int64_t(-1));
+      AddColumn(psAdapter, "latency_max_ns", &ProblemSetHeader::latency_max, int64_t(-1));
    }
 
    template<class T>
@@ -592,25 +1251,33 @@ namespace TestFramework
    {
       AddColumn<T, int>(prAdapter, "problem", &T::id, -1);
       AddColumn<T, int>(prAdapter, "student_answer", &T::student_answer, -1);
+      AddColumn<T, int>(prAdapter, "input_size", &T::input_size, -1);
+      AddColumn<T, int64_t>(prAdapter, "time_ns", &T::solve_time, -1);
    }
    ///////////////////////////////////////////////////////////////////////////////
 
-   StringSegment::StringSegment(const std::string& s) : str(s)
+   StringSegment::StringSegment(const std::string& s) : str(s.data())
    {
       iBegin = 0;
       iEnd = s.length();
    }
 
+   StringSegment::StringSegment(const char* begin, size_t length) : str(begin)
+   {
+      iBegin = 0;
+      iEnd = length;
+   }
+
    std::string StringSegment::ToString() const
    {
       std::string dest;
-      dest.assign(str, iBegin, iEnd - iBegin);
+      dest.assign(str + iBegin, iEnd - iBegin);
       return dest;
    }
 
    void StringSegment::CopyTo(std::string& dest) const
    {
-      dest.assign(str, iBegin, iEnd - iBegin);
+      dest.assign(str + iBegin, iEnd - iBegin);
    }
 
    bool StringSegment::CopyTo(char* buffer, size_t buffer_size) const
@@ -632,7 +1299,7 @@ namespace TestFramework
 
    size_t StringSegment::CountChars(char c) const
    {
-      return (std::count (str.begin() + iBegin, str.begin() + iEnd, c));
+      return (std::count (str + iBegin, str + iEnd, c));
    }
 
    bool StringSegment::IsEmpty() const
@@ -646,6 +1313,16 @@ namespace TestFramework
       return (iEnd - iBegin);
    }
 
+   const char* StringSegment::Begin() const
+   {
+      return str + iBegin;
+   }
+
+   const char* StringSegment::End() const
+   {
+      return str + iEnd;
+   }
+
    char StringSegment::ReadLeft()
    {
       char result = 0;
@@ -818,6 +1495,18 @@ namespace TestFramework
       Encode(var.*field_pointer, s);
    }
 
+   template<class T, class C>
+   void FieldAdapter<T, C>::ToBinary(const T& var, BinaryColumn& column) const
+   {
+      EncodeBinary(var.*field_pointer, column);
+   }
+
+   template<class T, class C>
+   bool FieldAdapter<T, C>::FromBinary(T& var, const BinaryColumnView& column, size_t row) const
+   {
+      return DecodeBinary(column, row, var.*field_pointer);
+   }
+
    template<class T, class C>
    bool FieldAdapter<T, C>::EqualsDefaultValue(const T& var) const
    {
@@ -830,6 +1519,91 @@ namespace TestFramework
       var.*field_pointer = defaultValue;
    }
 
+   MappedFile::MappedFile() : pData(nullptr), size(0), isMapped(false)
+   {
+      //empty
+   }
+
+   MappedFile::~MappedFile()
+   {
+      Close();
+   }
+
+   bool MappedFile::Open(const char* filename)
+   {
+      Close();
+
+#ifdef TEST_FRAMEWORK_MMAP
+      int fd = open(filename, O_RDONLY);
+      if (fd < 0) return false;
+
+      struct stat info;
+      if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode))
+      {
+         size = static_cast<size_t>(info.st_size);
+         if (size == 0)
+         {
+            close(fd);
+            return true;
+         }
+
+         void* pMapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (pMapping != MAP_FAILED)
+         {
+            madvise(pMapping, size, MADV_SEQUENTIAL);
+            close(fd);
+            pData = static_cast<const char*>(pMapping);
+            isMapped = true;
+            return true;
+         }
+      }
+
+      close(fd);
+      size = 0;
+#endif
+
+      // no mapping: read the whole file at once
+      std::ifstream input(filename, std::ios::in | std::ios::binary);
+      if (!input.good()) return false;
+
+      input.seekg(0, std::ios::end);
+      std::streamoff length = input.tellg();
+      input.seekg(0, std::ios::beg);
+      if (length < 0) return false;
+
+      buffer.resize(static_cast<size_t>(length));
+      input.read(&buffer[0], length);
+      if (input.gcount() != length) return false;
+
+      pData = buffer.data();
+      size = buffer.size();
+      return true;
+   }
+
+   void MappedFile::Close()
+   {
+#ifdef TEST_FRAMEWORK_MMAP
+      if (isMapped)
+      {
+         munmap(const_cast<char*>(pData), size);
+      }
+#endif
+      pData = nullptr;
+      size = 0;
+      isMapped = false;
+      buffer.clear();
+   }
+
+   const char* MappedFile::Data() const
+   {
+      return pData;
+   }
+
+   size_t MappedFile::Size() const
+   {
+      return size;
+   }
+
    AbstractLineParser::AbstractLineParser() : lineNumber(0), isOK (true)
    {
       //empty
@@ -851,30 +1625,98 @@ namespace TestFramework
       ClearErrors();
 
       lineNumber = 0;
-      std::ifstream input;
-      input.open(filename);
+      MappedFile input;
+
+      CheckCondition(input.Open(filename), "Cannot open input file.");
+      if (!IsOK()) return;
+
+      ParseLines(input.Data(), input.Size());
+   }
+
+   void AbstractLineParser::ParseBuffer(const char* data, size_t size, bool shouldExitOnError)
+   {
+      bExitOnError = shouldExitOnError;
+      ClearErrors();
+
+      lineNumber = 0;
+      ParseLines(data, size);
+   }
+
+   void AbstractLineParser::ParseStream(std::istream& input, bool shouldExitOnError)
+   {
+      bExitOnError = shouldExitOnError;
+      ClearErrors();
 
+      lineNumber = 0;
       CheckCondition(input.good(), "Cannot open input file.");
       if (!IsOK()) return;
 
       PreParse();
       if (!IsOK()) return;
 
-      while (!input.eof())
+      //the buffer grows beyond one block only for longer lines
+      const size_t blockSize = 64 * 1024;
+      std::vector<char> buffer;
+      size_t nPending = 0;
+      bool isLastBlock = false;
+
+      while (!isLastBlock)
+      {
+         buffer.resize(nPending + blockSize);
+         input.read(buffer.data() + nPending, blockSize);
+
+         size_t nRead = static_cast<size_t>(input.gcount());
+         isLastBlock = (nRead < blockSize);
+
+         size_t size = nPending + nRead;
+         size_t nConsumed = ParseBlock(buffer.data(), size, isLastBlock);
+         if (!IsOK()) return;
+
+         nPending = size - nConsumed;
+         memmove(buffer.data(), buffer.data() + nConsumed, nPending);
+      }
+
+      PostParse();
+   }
+
+   void AbstractLineParser::ParseLines(const char* data, size_t size)
+   {
+      PreParse();
+      if (!IsOK()) return;
+
+      ParseBlock(data, size, true);
+      if (!IsOK()) return;
+
+      PostParse();
+   }
+
+   // Lines are segments of the buffer itself: nothing is copied. An
+   // unterminated line at the end is left for the next block, unless this is
+   // the last one. Returns the number of bytes consumed.
+   size_t AbstractLineParser::ParseBlock(const char* data, size_t size, bool isLastBlock)
+   {
+      const char* pEnd = data + size;
+      const char* pLine = data;
+
+      while (pLine < pEnd)
       {
+         const char* pNewline = static_cast<const char*>(memchr(pLine, '\n', pEnd - pLine));
+         if ((pNewline == nullptr) && !isLastBlock) break;
+
          lineNumber++;
-         std::string str;
-         std::getline(input, str);
-         StringSegment segment(str);
+         const char* pLineEnd = (pNewline != nullptr) ? pNewline : pEnd;
+         StringSegment segment(pLine, pLineEnd - pLine);
 
          if (!segment.IsEmpty())
          {
             ParseLine(segment);
-            if (!IsOK()) return;
+            if (!IsOK()) break;
          }
+
+         pLine = pLineEnd + 1;
       }
 
-      PostParse();
+      return std::min(pLine, pEnd) - data;
    }
 
    void AbstractLineParser::CheckCondition(bool bCondition, const char* error)
@@ -940,6 +1782,26 @@ namespace TestFramework
       return bResult;
    }
 
+   std::unique_ptr<ITable> ITable::NewShard() const
+   {
+      return nullptr;
+   }
+
+   bool ITable::MergeShard(ITable& /* shard */)
+   {
+      return false;
+   }
+
+   bool ITable::GetColumn(size_t /* col */, BinaryColumn& /* column */) const
+   {
+      return false;
+   }
+
+   bool ITable::SetColumn(size_t /* col */, const BinaryColumnView& /* column */)
+   {
+      return false;
+   }
+
    template<class T>
    bool AbstractTableAdapter<T>::AddNamedColumn(const char* name, std::shared_ptr<BaseFieldAdapter<T>> pField)
    {
@@ -1044,6 +1906,46 @@ namespace TestFramework
       return columnSpecs.size();
    }
 
+   template<class T>
+   bool AbstractTableAdapter<T>::GetColumn(size_t col, BinaryColumn& column) const
+   {
+      assert(col < columnSpecs.size());
+
+      column = BinaryColumn();
+      size_t nRows = RowCount();
+
+      for (size_t row = 0; row < nRows; row++)
+      {
+         columnSpecs[col].fieldAdapter->ToBinary(GetRecord(row), column);
+      }
+
+      return true;
+   }
+
+   template<class T>
+   bool AbstractTableAdapter<T>::SetColumn(size_t col, const BinaryColumnView& column)
+   {
+      assert(col < columnSpecs.size());
+
+      size_t nRows = RowCount();
+      bool bResult = true;
+
+      for (size_t row = 0; (row < nRows) && bResult; row++)
+      {
+         bResult = columnSpecs[col].fieldAdapter->FromBinary(GetRecord(row), column, row);
+      }
+
+      return bResult;
+   }
+
+   // Same columns as another adapter, over different data
+   template<class T>
+   TableAdapter<T>::TableAdapter(std::vector<T>& data, const AbstractTableAdapter<T>& columns) :
+      AbstractTableAdapter<T>(columns), data(data)
+   {
+      //empty
+   }
+
    template<class T>
    bool TableAdapter<T>::NewRow(size_t& row)
    {
@@ -1065,6 +1967,29 @@ namespace TestFramework
       return false;
    }
 
+   template<class T>
+   std::unique_ptr<ITable> TableAdapter<T>::NewShard() const
+   {
+      std::unique_ptr<TableAdapter<T>> pShard(new TableAdapter<T>());
+
+      //same columns, no rows
+      static_cast<AbstractTableAdapter<T>&>(*pShard) = *this;
+      return std::unique_ptr<ITable>(pShard.release());
+   }
+
+   template<class T>
+   bool TableAdapter<T>::MergeShard(ITable& shard)
+   {
+      TableAdapter<T>* pShard = dynamic_cast<TableAdapter<T>*>(&shard);
+      if (pShard == nullptr) return false;
+
+      data.insert(data.end(),
+                  std::make_move_iterator(pShard->data.begin()),
+                  std::make_move_iterator(pShard->data.end()));
+      pShard->data.clear();
+      return true;
+   }
+
    template<class T>
    T& TableAdapter<T>::GetRecord(size_t i)
    {
@@ -1111,208 +2036,1574 @@ namespace TestFramework
       return data;
    }
 
-   BasicYamlParser::BasicYamlParser(ITable* pHeader, ITable* pTable) :
-                           AbstractLineParser(), pHeader(pHeader), pTable(pTable), isHeaderSection(true)
+   template<class T, class Schema>
+   StaticTableAdapter<T, Schema>::StaticTableAdapter(std::vector<T>& data) : data(data)
    {
-      assert(pHeader != nullptr);
-      assert(pHeader->RowCount() > 0);
-      assert(pTable != nullptr);
-      assert(!pTable->IsFixedSize());
+      constexpr Fields fields = Schema::Fields();
+      auto addName = [&](const auto& field) { names.emplace_back(field.name); return true; };
+
+      for (size_t col = 0; col < fieldCount; col++)
+      {
+         VisitSchemaField(fields, col, addName);
+      }
    }
 
-   void BasicYamlParser::SetHeaderAdapter(ITable* newAdapter)
+   template<class T, class Schema>
+   const typename StaticTableAdapter<T, Schema>::Index& StaticTableAdapter<T, Schema>::GetIndex()
    {
-      assert(newAdapter != nullptr);
-      assert(newAdapter->RowCount() > 0);
-      pHeader = newAdapter;
+      static constexpr Index index =
+         BuildSchemaIndex<sizeof(Index::slots)>(Schema::Fields(), std::make_index_sequence<fieldCount>());
+
+      static_assert(index.isPerfect, "Column names in a schema must differ.");
+      return index;
    }
 
-   void BasicYamlParser::SetTableAdapter(ITable* newAdapter)
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::NewRow(size_t& row)
    {
-      assert(newAdapter != nullptr);
-      assert(!newAdapter->IsFixedSize());
-      pTable = newAdapter;
+      data.emplace_back();
+      row = data.size() - 1;
+      SetDefaultValues(row);
+      return true;
    }
 
-   void BasicYamlParser::PreParse()
+   template<class T, class Schema>
+   void StaticTableAdapter<T, Schema>::SetDefaultValues(size_t row)
    {
-      isHeaderSection = true;
+      assert(row < data.size());
+
+      constexpr Fields fields = Schema::Fields();
+      T& record = data[row];
+      auto setDefault = [&](const auto& field) { record.*field.field_pointer = field.GetDefaultValue(); return true; };
+
+      for (size_t col = 0; col < fieldCount; col++)
+      {
+         VisitSchemaField(fields, col, setDefault);
+      }
    }
 
-   void BasicYamlParser::ParseLine(StringSegment s)
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::IsFixedSize() const
    {
-      assert(pTable != nullptr);
+      return false;
+   }
 
-      s.Trim();
-      if (s.IsEmpty()) return;
+   template<class T, class Schema>
+   const std::string& StaticTableAdapter<T, Schema>::GetColumnName(size_t col) const
+   {
+      assert(col < names.size());
+      return names[col];
+   }
 
-      char firstChar = s.FirstChar();
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::GetValue(size_t row, size_t col, std::string& value) const
+   {
+      assert(row < data.size());
 
-      if (firstChar == '#')
-      {
-         //comments
-         return;
-      }
+      constexpr Fields fields = Schema::Fields();
+      const T& record = data[row];
+      auto encode = [&](const auto& field) { Encode(record.*field.field_pointer, value); return true; };
+
+      return VisitSchemaField(fields, col, encode);
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::SetValue(size_t row, size_t col, StringSegment value)
+   {
+      assert(row < data.size());
+
+      constexpr Fields fields = Schema::Fields();
+      T& record = data[row];
+      auto parse = [&](const auto& field) { return Parse(value, record.*field.field_pointer); };
+
+      return VisitSchemaField(fields, col, parse);
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::SetValue(size_t row, StringSegment key, StringSegment value)
+   {
+      size_t col = 0;
+      return GetColumnByName(key, col) && SetValue(row, col, value);
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::GetColumnByName(StringSegment key, size_t& col) const
+   {
+      const Index& index = GetIndex();
+      uint32_t hash = SchemaHash(key.Begin(), key.Length(), index.seed);
+      size_t slot = index.slots[hash & (sizeof(index.slots) - 1)];
+
+      if (slot == 0) return false; /* not found */
+
+      const std::string& name = names[slot - 1];
+      if (name.size() != key.Length()) return false;
+
+      for (size_t i = 0; i < name.size(); i++)
+      {
+         if (SchemaToLower(name[i]) != SchemaToLower(key[i])) return false;
+      }
+
+      col = slot - 1;
+      return true;
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::EqualsDefaultValue(size_t row, size_t col) const
+   {
+      assert(row < data.size());
+
+      constexpr Fields fields = Schema::Fields();
+      const T& record = data[row];
+      auto isDefault = [&](const auto& field) { return record.*field.field_pointer == field.GetDefaultValue(); };
+
+      return VisitSchemaField(fields, col, isDefault);
+   }
+
+   template<class T, class Schema>
+   size_t StaticTableAdapter<T, Schema>::ColumnCount() const
+   {
+      return fieldCount;
+   }
+
+   template<class T, class Schema>
+   size_t StaticTableAdapter<T, Schema>::RowCount() const
+   {
+      return data.size();
+   }
+
+   template<class T, class Schema>
+   std::unique_ptr<ITable> StaticTableAdapter<T, Schema>::NewShard() const
+   {
+      return std::unique_ptr<ITable>(new StaticTableAdapter<T, Schema>());
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::MergeShard(ITable& shard)
+   {
+      StaticTableAdapter<T, Schema>* pShard = dynamic_cast<StaticTableAdapter<T, Schema>*>(&shard);
+      if (pShard == nullptr) return false;
+
+      data.insert(data.end(),
+                  std::make_move_iterator(pShard->data.begin()),
+                  std::make_move_iterator(pShard->data.end()));
+      pShard->data.clear();
+      return true;
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::GetColumn(size_t col, BinaryColumn& column) const
+   {
+      constexpr Fields fields = Schema::Fields();
+      column = BinaryColumn();
+
+      auto encode = [&](const auto& field)
+      {
+         for (const T& record : data)
+         {
+            EncodeBinary(record.*field.field_pointer, column);
+         }
+         return true;
+      };
+
+      return VisitSchemaField(fields, col, encode);
+   }
+
+   template<class T, class Schema>
+   bool StaticTableAdapter<T, Schema>::SetColumn(size_t col, const BinaryColumnView& column)
+   {
+      constexpr Fields fields = Schema::Fields();
+
+      auto decode = [&](const auto& field)
+      {
+         bool bResult = true;
+         for (size_t row = 0; (row < data.size()) && bResult; row++)
+         {
+            bResult = DecodeBinary(column, row, data[row].*field.field_pointer);
+         }
+         return bResult;
+      };
+
+      return VisitSchemaField(fields, col, decode);
+   }
+
+   BasicYamlParser::BasicYamlParser(ITable* pHeader, ITable* pTable) :
+                           AbstractLineParser(), pHeader(pHeader), pTable(pTable), isHeaderSection(true)
+   {
+      assert(pHeader != nullptr);
+      assert(pHeader->RowCount() > 0);
+      assert(pTable != nullptr);
+      assert(!pTable->IsFixedSize());
+   }
+
+   void BasicYamlParser::SetHeaderAdapter(ITable* newAdapter)
+   {
+      assert(newAdapter != nullptr);
+      assert(newAdapter->RowCount() > 0);
+      pHeader = newAdapter;
+   }
+
+   void BasicYamlParser::SetTableAdapter(ITable* newAdapter)
+   {
+      assert(newAdapter != nullptr);
+      assert(!newAdapter->IsFixedSize());
+      pTable = newAdapter;
+   }
+
+   void BasicYamlParser::PreParse()
+   {
+      isHeaderSection = !isDataShard;
+   }
+
+   void BasicYamlParser::PostParse()
+   {
+      //the last record ends with the file
+      if (recordHandler && !isHeaderSection && (pTable->RowCount() > 0))
+      {
+         recordHandler(pTable->RowCount() - 1);
+      }
+   }
+
+   void BasicYamlParser::ParseFileStreaming(const char* filename, std::function<void(size_t)> onRecord,
+                                            bool shouldExitOnError)
+   {
+      std::ifstream input(filename, std::ios::in | std::ios::binary);
+
+      recordHandler = onRecord;
+      ParseStream(input, shouldExitOnError);
+      recordHandler = nullptr;
+   }
+
+   void BasicYamlParser::ParseFileParallel(const char* filename, bool shouldExitOnError,
+                                           size_t threadCount)
+   {
+      MappedFile input;
+      if (!input.Open(filename))
+      {
+         ParseFile(filename, shouldExitOnError);
+         return;
+      }
+
+      ParseBufferParallel(input.Data(), input.Size(), shouldExitOnError, threadCount);
+   }
+
+   void BasicYamlParser::ParseBufferParallel(const char* data, size_t size, bool shouldExitOnError,
+                                             size_t threadCount)
+   {
+      //shards smaller than this are not worth a thread
+      const size_t minShardSize = 64 * 1024;
+
+      const char* pBegin = data;
+      const char* pEnd = data + size;
+      const char* pBody = FindDataSection(pBegin, pEnd);
+
+      if (threadCount == 0)
+      {
+         threadCount = std::max(1u, std::thread::hardware_concurrency());
+      }
+
+      size_t bodySize = pEnd - pBody;
+      size_t nShards = std::min(threadCount, bodySize / minShardSize);
+
+      std::vector<std::unique_ptr<ITable>> shards;
+      for (size_t i = 0; (i < nShards) && (nShards > 1); i++)
+      {
+         std::unique_ptr<ITable> pShard = pTable->NewShard();
+         if (!pShard) break;
+         shards.push_back(std::move(pShard));
+      }
+
+      if ((nShards <= 1) || (shards.size() != nShards))
+      {
+         ParseBuffer(pBegin, size, shouldExitOnError);
+         return;
+      }
+
+      //header and the "data:" line
+      ParseBuffer(pBegin, pBody - pBegin, shouldExitOnError);
+      if (!IsOK()) return;
+
+      //shard boundaries are the record starts nearest to equal splits
+      std::vector<const char*> bounds(nShards + 1);
+      bounds[0] = pBody;
+      bounds[nShards] = pEnd;
+      for (size_t i = 1; i < nShards; i++)
+      {
+         const char* pSplit = std::max(pBody + i * bodySize / nShards, bounds[i - 1]);
+         const char* pNewline = static_cast<const char*>(memchr(pSplit, '\n', pEnd - pSplit));
+         bounds[i] = (pNewline != nullptr) ? FindRecordStart(pNewline + 1, pEnd) : pEnd;
+      }
+
+      std::vector<char> shardOK(nShards, 0);
+      auto parseShard = [&](size_t i)
+      {
+         BasicYamlParser shardParser(pHeader, shards[i].get());
+         shardParser.isDataShard = true;
+         shardParser.ParseBuffer(bounds[i], bounds[i + 1] - bounds[i], false);
+         shardOK[i] = shardParser.IsOK();
+      };
+
+      std::vector<std::thread> workers;
+      for (size_t i = 1; i < nShards; i++)
+      {
+         workers.emplace_back(parseShard, i);
+      }
+      parseShard(0);
+
+      for (auto& worker : workers)
+      {
+         worker.join();
+      }
+
+      bool bAllOK = std::all_of(shardOK.begin(), shardOK.end(), [](char ok) { return ok != 0; });
+      if (!bAllOK)
+      {
+         //reparse serially to report the first error with its line number
+         ParseBuffer(pBegin, size, shouldExitOnError);
+         return;
+      }
+
+      for (auto& pShard : shards)
+      {
+         CheckCondition(pTable->MergeShard(*pShard), "Cannot merge parsed data.");
+         if (!IsOK()) return;
+      }
+   }
+
+   void BasicYamlParser::ParseFileCached(const char* filename, bool shouldExitOnError,
+                                         size_t threadCount)
+   {
+      MappedFile input;
+      if (!input.Open(filename))
+      {
+         ParseFile(filename, shouldExitOnError);
+         return;
+      }
+
+      std::string cacheFilename(filename);
+      cacheFilename.append(".cache");
+
+      SourceFileKey key;
+      bool hasKey = GetSourceFileKey(filename, input, key);
+
+      if (hasKey && LoadTableCache(cacheFilename.c_str(), key, pHeader, pTable))
+      {
+         ClearErrors();
+         return;
+      }
+
+      ParseBufferParallel(input.Data(), input.Size(), shouldExitOnError, threadCount);
+
+      if (hasKey && IsOK())
+      {
+         //a missing or read-only directory only costs the next run a parse
+         SaveTableCache(cacheFilename.c_str(), key, pHeader, pTable);
+      }
+   }
+
+   // Returns the first byte after the "data:" line, or pEnd if there is none
+   const char* BasicYamlParser::FindDataSection(const char* pBegin, const char* pEnd)
+   {
+      const char* pLine = pBegin;
+
+      while (pLine < pEnd)
+      {
+         const char* pNewline = static_cast<const char*>(memchr(pLine, '\n', pEnd - pLine));
+         const char* pLineEnd = (pNewline != nullptr) ? pNewline : pEnd;
+
+         StringSegment segment(pLine, pLineEnd - pLine);
+         segment.Trim();
+
+         if (!segment.IsEmpty() && (segment.FirstChar() != '#') && segment.Match("data:"))
+         {
+            return std::min(pLineEnd + 1, pEnd);
+         }
+
+         pLine = pLineEnd + 1;
+      }
+
+      return pEnd;
+   }
+
+   // Returns the first line at or after pBegin that starts a new record
+   const char* BasicYamlParser::FindRecordStart(const char* pBegin, const char* pEnd)
+   {
+      const char* pLine = pBegin;
+
+      while (pLine < pEnd)
+      {
+         const char* pNewline = static_cast<const char*>(memchr(pLine, '\n', pEnd - pLine));
+         const char* pLineEnd = (pNewline != nullptr) ? pNewline : pEnd;
+
+         StringSegment segment(pLine, pLineEnd - pLine);
+         segment.Trim();
+
+         if (!segment.IsEmpty() && (segment.FirstChar() == '-')) return pLine;
+
+         pLine = pLineEnd + 1;
+      }
+
+      return pEnd;
+   }
+
+   void BasicYamlParser::ParseLine(StringSegment s)
+   {
+      assert(pTable != nullptr);
+
+      s.Trim();
+      if (s.IsEmpty()) return;
+
+      char firstChar = s.FirstChar();
+
+      if (firstChar == '#')
+      {
+         //comments
+         return;
+      }
       else if (s.Match("data:"))
       {
-         //start data section
-         isHeaderSection = false;
-         return;
+         //start data section
+         isHeaderSection = false;
+         return;
+      }
+      else if (firstChar == '-')
+      {
+         CheckCondition(!isHeaderSection, "Invalid entry in the header section.");
+
+         //a new record completes the previous one
+         if (recordHandler && (pTable->RowCount() > 0))
+         {
+            recordHandler(pTable->RowCount() - 1);
+         }
+
+         size_t row;
+         pTable->NewRow(row);
+         s.RemovePrefix(1);
+
+         s.Trim();
+         if (s.IsEmpty()) return;
+      }
+
+      StringSegment prefix(s);
+      s.Split(':', prefix);
+      s.Trim();
+      prefix.Trim();
+
+      CheckCondition(!s.IsEmpty() && !prefix.IsEmpty(), "Key or value is empty.");
+      if (!IsOK()) return;
+
+      if (isHeaderSection)
+      {
+         CheckCondition(pHeader != nullptr, "Unexpected header.");
+         if (!IsOK()) return;
+
+         bool bResult = pHeader->SetValue(0, prefix, s);
+
+         CheckCondition(bResult, "Cannot parse a line.");
+         if (!IsOK()) return;
+      }
+      else
+      {
+         size_t tableSize = pTable->RowCount();
+         bool bResult = pTable->SetValue(tableSize - 1, prefix, s);
+
+         CheckCondition(bResult, "Cannot parse a line.");
+         if (!IsOK()) return;
+      }
+   }
+
+   // Binary cache layout, in native byte order and 32-bit words:
+   //    magic, format version, framework version, source key (6 words),
+   //    then the header and the table, each as
+   //       row count, column count, and for every column:
+   //       name length, name (padded to a word), list flag, value count,
+   //       row count + 1 offsets for list columns, values.
+   constexpr uint32_t cacheMagic = 0x43504654; // "TFPC"
+   constexpr uint32_t cacheFormatVersion = 1;
+
+   // FNV-1a over 64-bit words, then over the remaining bytes
+   uint64_t HashBytes(const char* data, size_t size)
+   {
+      const uint64_t prime = 1099511628211ull;
+      uint64_t hash = 14695981039346656037ull;
+
+      size_t i = 0;
+      for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+      {
+         uint64_t word;
+         memcpy(&word, data + i, sizeof(word));
+         hash = (hash ^ word) * prime;
+      }
+
+      for (; i < size; i++)
+      {
+         hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+      }
+
+      return hash;
+   }
+
+   bool GetSourceFileKey(const char* filename, const MappedFile& contents, SourceFileKey& key)
+   {
+      struct stat info;
+      if (stat(filename, &info) != 0) return false;
+
+      key.size = contents.Size();
+      key.mtime = static_cast<int64_t>(info.st_mtime);
+      key.hash = HashBytes(contents.Data(), contents.Size());
+      return true;
+   }
+
+   void AppendWord(std::string& out, uint32_t word)
+   {
+      out.append(reinterpret_cast<const char*>(&word), sizeof(word));
+   }
+
+   void AppendKey(std::string& out, const SourceFileKey& key)
+   {
+      uint64_t mtime = static_cast<uint64_t>(key.mtime);
+      uint64_t words[3] = { key.size, mtime, key.hash };
+
+      for (uint64_t word : words)
+      {
+         AppendWord(out, static_cast<uint32_t>(word));
+         AppendWord(out, static_cast<uint32_t>(word >> 32));
+      }
+   }
+
+   bool AppendTable(std::string& out, const ITable* table)
+   {
+      size_t nRows = table->RowCount();
+      size_t nCols = table->ColumnCount();
+
+      AppendWord(out, static_cast<uint32_t>(nRows));
+      AppendWord(out, static_cast<uint32_t>(nCols));
+
+      BinaryColumn column;
+      for (size_t col = 0; col < nCols; col++)
+      {
+         if (!table->GetColumn(col, column)) return false;
+
+         const std::string& name = table->GetColumnName(col);
+         AppendWord(out, static_cast<uint32_t>(name.size()));
+         out.append(name);
+         out.append((4 - name.size() % 4) % 4, '\0');
+
+         AppendWord(out, column.isList ? 1 : 0);
+         AppendWord(out, static_cast<uint32_t>(column.values.size()));
+
+         if (column.isList)
+         {
+            out.append(reinterpret_cast<const char*>(column.offsets.data()),
+                       column.offsets.size() * sizeof(uint32_t));
+         }
+
+         out.append(reinterpret_cast<const char*>(column.values.data()),
+                    column.values.size() * sizeof(int32_t));
+      }
+
+      return true;
+   }
+
+   bool SaveTableCache(const char* cacheFilename, const SourceFileKey& key,
+                       const ITable* header, const ITable* table)
+   {
+      std::string contents;
+      AppendWord(contents, cacheMagic);
+      AppendWord(contents, cacheFormatVersion);
+      AppendWord(contents, GetTestFrameworkVersion());
+      AppendKey(contents, key);
+
+      if (!AppendTable(contents, header) || !AppendTable(contents, table)) return false;
+
+      //write a temporary file first so that readers never see a partial cache
+      std::string tempFilename(cacheFilename);
+      tempFilename.append(".tmp");
+
+      std::ofstream output(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!output.good()) return false;
+
+      output.write(contents.data(), contents.size());
+      output.close();
+
+      if (!output.good())
+      {
+         std::remove(tempFilename.c_str());
+         return false;
+      }
+
+      std::remove(cacheFilename);
+      return (std::rename(tempFilename.c_str(), cacheFilename) == 0);
+   }
+
+   // Reads 32-bit words from a mapped cache file with bounds checks
+   class CacheReader
+   {
+   public:
+      CacheReader(const char* data, size_t size) :
+         pWords(reinterpret_cast<const uint32_t*>(data)), nWords(size / 4), pos(0) {};
+
+      bool Read(uint32_t& word)
+      {
+         if (pos >= nWords) return false;
+         word = pWords[pos++];
+         return true;
+      }
+
+      const uint32_t* Skip(size_t count)
+      {
+         if (count > nWords - pos) return nullptr;
+         const uint32_t* pResult = pWords + pos;
+         pos += count;
+         return pResult;
+      }
+
+   private:
+      const uint32_t* pWords;
+      size_t nWords;
+      size_t pos;
+   };
+
+   struct CachedColumn
+   {
+      size_t col;
+      BinaryColumnView view;
+   };
+
+   BinaryColumnView ViewOf(const BinaryColumn& column)
+   {
+      BinaryColumnView view;
+      view.isList = column.isList;
+      view.offsets = column.offsets.data();
+      view.values = column.values.data();
+      view.valueCount = column.values.size();
+      return view;
+   }
+
+   // Checks a table section against the current columns without changing anything
+   bool ReadTableSection(CacheReader& reader, const ITable* table,
+                         size_t& nRows, std::vector<CachedColumn>& columns)
+   {
+      uint32_t rows = 0;
+      uint32_t nCols = 0;
+      if (!reader.Read(rows) || !reader.Read(nCols)) return false;
+      if (nCols != table->ColumnCount()) return false;
+
+      nRows = rows;
+      columns.clear();
+      std::vector<bool> isSeen(nCols, false);
+
+      for (uint32_t i = 0; i < nCols; i++)
+      {
+         uint32_t nameLength = 0;
+         if (!reader.Read(nameLength)) return false;
+
+         const uint32_t* pName = reader.Skip((nameLength + 3) / 4);
+         if (pName == nullptr) return false;
+
+         CachedColumn column;
+         StringSegment name(reinterpret_cast<const char*>(pName), nameLength);
+         if (!table->GetColumnByName(name, column.col) || isSeen[column.col]) return false;
+         isSeen[column.col] = true;
+
+         uint32_t isList = 0;
+         uint32_t valueCount = 0;
+         if (!reader.Read(isList) || !reader.Read(valueCount)) return false;
+
+         column.view.isList = (isList != 0);
+         column.view.valueCount = valueCount;
+
+         if (column.view.isList)
+         {
+            if (nRows == 0) return false;
+
+            column.view.offsets = reader.Skip(nRows + 1);
+            if (column.view.offsets == nullptr) return false;
+
+            const uint32_t* offsets = column.view.offsets;
+            if ((offsets[0] != 0) || (offsets[nRows] != valueCount)) return false;
+
+            for (size_t row = 0; row < nRows; row++)
+            {
+               if (offsets[row] > offsets[row + 1]) return false;
+            }
+         }
+         else if (valueCount != nRows)
+         {
+            return false;
+         }
+
+         const uint32_t* pValues = reader.Skip(valueCount);
+         if (pValues == nullptr) return false;
+         column.view.values = reinterpret_cast<const int32_t*>(pValues);
+
+         columns.push_back(column);
+      }
+
+      return true;
+   }
+
+   bool LoadTableCache(const char* cacheFilename, const SourceFileKey& key,
+                       ITable* header, ITable* table)
+   {
+      if ((header->RowCount() != 1) || (table->RowCount() != 0)) return false;
+
+      MappedFile input;
+      if (!input.Open(cacheFilename)) return false;
+
+      std::string expected;
+      AppendWord(expected, cacheMagic);
+      AppendWord(expected, cacheFormatVersion);
+      AppendWord(expected, GetTestFrameworkVersion());
+      AppendKey(expected, key);
+
+      if ((input.Size() < expected.size()) ||
+          (memcmp(input.Data(), expected.data(), expected.size()) != 0))
+      {
+         return false;
+      }
+
+      CacheReader reader(input.Data(), input.Size());
+      reader.Skip(expected.size() / 4);
+
+      size_t nHeaderRows = 0;
+      size_t nTableRows = 0;
+      std::vector<CachedColumn> headerColumns;
+      std::vector<CachedColumn> tableColumns;
+
+      if (!ReadTableSection(reader, header, nHeaderRows, headerColumns) ||
+          !ReadTableSection(reader, table, nTableRows, tableColumns) ||
+          (nHeaderRows != 1))
+      {
+         return false;
+      }
+
+      //fill a shard, merged only once the header is set too, so that a
+      //rejected cache leaves the table empty
+      std::unique_ptr<ITable> pShard = table->NewShard();
+      if (!pShard) return false;
+
+      for (size_t row = 0; row < nTableRows; row++)
+      {
+         size_t newRow;
+         if (!pShard->NewRow(newRow)) return false;
+      }
+
+      for (const CachedColumn& column : tableColumns)
+      {
+         if (!pShard->SetColumn(column.col, column.view)) return false;
+      }
+
+      //the header is a single record, so it is saved and restored on failure
+      std::vector<BinaryColumn> savedHeader(header->ColumnCount());
+      for (size_t col = 0; col < savedHeader.size(); col++)
+      {
+         if (!header->GetColumn(col, savedHeader[col])) return false;
+      }
+
+      bool bResult = true;
+      for (const CachedColumn& column : headerColumns)
+      {
+         bResult = bResult && header->SetColumn(column.col, column.view);
+      }
+
+      bResult = bResult && table->MergeShard(*pShard);
+
+      if (!bResult)
+      {
+         for (size_t col = 0; col < savedHeader.size(); col++)
+         {
+            header->SetColumn(col, ViewOf(savedHeader[col]));
+         }
+      }
+
+      return bResult;
+   }
+
+   void WriteRecordToStream(std::ostream& out, ITable* table,
+                            size_t row, bool bWriteDefaultValues,
+                            bool bIndent)
+   {
+      if (bIndent) out << std::endl;
+
+      size_t nCols = table->ColumnCount();
+      for (size_t j = 0; j < nCols; j++)
+      {
+          if (bIndent && (j == 0))
+         {
+            out << " - ";
+         }
+
+         if (bWriteDefaultValues || !table->EqualsDefaultValue(row, j))
+         {
+            if (bIndent && (j != 0))
+            {
+               out << "   ";
+            }
+
+            out << table->GetColumnName(j) << ": ";
+            std::string value;
+            table->GetValue(row, j, value);
+            out << value << std::endl;
+         }
+      }
+   }
+
+   void WriteTableToStream(std::ostream& out, ITable* table, ITable* header /* can be nullptr */,
+                           bool bWriteDefaultValues)
+   {
+      assert(table != nullptr);
+
+      size_t nRows = table->RowCount();
+
+      if (header != nullptr)
+      {
+         WriteRecordToStream(out, header, 0, bWriteDefaultValues, false);
+      }
+
+      out << std::endl << "data:" << std::endl;
+      for (size_t i = 0; i < nRows; i++)
+      {
+         WriteRecordToStream(out, table, i, bWriteDefaultValues, true);
+      }
+   }
+
+   void WriteTableToFile(const char* filename, ITable* header, ITable* table,
+                         bool bWriteDefaultValues, const char* comments)
+   {
+      std::ofstream out;
+      out.open(filename);
+      ExitIfConditionFails(out.good(), "Cannot open output file!");
+
+      if (comments != nullptr)
+      {
+         out << comments;
+      }
+
+      WriteTableToStream(out, header, table, bWriteDefaultValues);
+
+      out.close();
+   }
+
+   LatencyHistogram::LatencyHistogram() :
+      counts(2 * subBucketCount + (63 - subBucketBits) * subBucketCount, 0), totalCount(0), maxValue(0)
+   {
+   }
+
+   size_t LatencyHistogram::BucketIndex(uint64_t value)
+   {
+      if (value < 2 * subBucketCount) return static_cast<size_t>(value);
+
+      int exponent = 0;
+      for (uint64_t rest = value >> 1; rest != 0; rest >>= 1)
+      {
+         exponent++;
+      }
+
+      //the leading subBucketBits + 1 bits select the sub-bucket
+      int shift = exponent - subBucketBits;
+      return static_cast<size_t>(2 * subBucketCount + (shift - 1) * subBucketCount +
+                                 ((value >> shift) - subBucketCount));
+   }
+
+   uint64_t LatencyHistogram::BucketHighestValue(size_t index)
+   {
+      if (index < 2 * subBucketCount) return index;
+
+      size_t rest = index - 2 * subBucketCount;
+      int shift = static_cast<int>(rest / subBucketCount) + 1;
+      uint64_t top = subBucketCount + rest % subBucketCount;
+      return ((top + 1) << shift) - 1;
+   }
+
+   void LatencyHistogram::Record(int64_t value)
+   {
+      value = std::max<int64_t>(value, 0);
+
+      counts[BucketIndex(static_cast<uint64_t>(value))]++;
+      totalCount++;
+      maxValue = std::max(maxValue, value);
+   }
+
+   // The smallest recorded value (up to the bucket width) that is greater
+   // than or equal to the given percentage of all values
+   int64_t LatencyHistogram::ValueAtPercentile(double percentile) const
+   {
+      if (totalCount == 0) return -1;
+
+      uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100 * totalCount));
+      target = std::min<uint64_t>(std::max<uint64_t>(target, 1), totalCount);
+
+      uint64_t nSeen = 0;
+      for (size_t index = 0; index < counts.size(); index++)
+      {
+         nSeen += counts[index];
+         if (nSeen >= target)
+         {
+            return std::min(static_cast<int64_t>(BucketHighestValue(index)), maxValue);
+         }
+      }
+
+      return maxValue;
+   }
+
+   std::string FormatLatency(int64_t nanoseconds)
+   {
+      char buffer[32];
+
+      if (nanoseconds < 1000)
+      {
+         std::snprintf(buffer, sizeof(buffer), "%d ns", static_cast<int>(nanoseconds));
+      }
+      else if (nanoseconds < 1000000)
+      {
+         std::snprintf(buffer, sizeof(buffer), "%.1f us", nanoseconds / 1e3);
+      }
+      else if (nanoseconds < 1000000000)
+      {
+         std::snprintf(buffer, sizeof(buffer), "%.1f ms", nanoseconds / 1e6);
+      }
+      else
+      {
+         std::snprintf(buffer, sizeof(buffer), "%.2f s", nanoseconds / 1e9);
+      }
+
+      return buffer;
+   }
+
+   // Solves one problem and records in it how long the solver took
+   template<class T, class Solver>
+   void SolveAndTime(T& theProblem, Solver& solve)
+   {
+      std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+      solve(theProblem);
+      std::chrono::steady_clock::duration solveTime = std::chrono::steady_clock::now() - tStart;
+
+      theProblem.solve_time = std::chrono::duration_cast<std::chrono::nanoseconds>(solveTime).count();
+   }
+
+   template<class T>
+   void RecordLatency(const T& theProblem, ProblemSetHeader& header)
+   {
+      if (theProblem.solve_time > header.latency.Max() || header.latency.Count() == 0)
+      {
+         header.slowest_problem = theProblem.id;
+      }
+
+      header.latency.Record(theProblem.solve_time);
+   }
+
+   // Fills in the latency fields of the header and prints them
+   void ReportLatency(ProblemSetHeader& header)
+   {
+      if (header.latency.Count() == 0) return;
+
+      header.latency_p50 = header.latency.ValueAtPercentile(50);
+      header.latency_p90 = header.latency.ValueAtPercentile(90);
+      header.latency_p99 = header.latency.ValueAtPercentile(99);
+      header.latency_max = header.latency.Max();
+
+      std::cout << "Time per problem: p50 " << FormatLatency(header.latency_p50)
+                << ", p90 " << FormatLatency(header.latency_p90)
+                << ", p99 " << FormatLatency(header.latency_p99)
+                << ", max " << FormatLatency(header.latency_max)
+                << " (problem #" << header.slowest_problem << ")." << std::endl;
+   }
+
+   template<class T>
+   void PreprocessProblemSet(int problem_set_id, std::vector<T>& problems, ProblemSetHeader& header)
+   {
+      ExitIfConditionFails(header.id == problem_set_id, "Wrong problem set. Check problem set number.");
+      ExitIfConditionFails(header.problem_count == (int) problems.size(), "Input file is corrupted.");
+      ExitIfConditionFails(!header.student_name.empty (), "Please, enter your name in 'GetStudentName' function.");
+
+      for (int i = 0; i < header.problem_count; i++)
+      {
+         ExitIfConditionFails(problems[i].id == (i + 1), "Input file is corrupted.");
+      }
+
+      header.tStart = std::chrono::high_resolution_clock::now();
+   }
+
+   template<class T>
+   void ReportMistake(const T& theProblem, int i)
+   {
+      std::cout << std::endl;
+      std::cout << "Mistake in problem #" << (i + 1) << "." << std::endl;
+      std::cout << "Correct answer: " << theProblem.correct_answer << "." << std::endl;
+      std::cout << "Your answer: " << theProblem.student_answer << "." << std::endl;
+      std::cout << "=========================";
+   }
+
+   void ReportSummary(int nMistakes)
+   {
+      if (nMistakes > 0)
+      {
+         std::cout << std::endl << "Your algorithm made " << nMistakes << " mistake(s)." << std::endl;
+      }
+      else
+      {
+         std::cout << "Your algorithm solved all test problems correctly. Congratulations!" << std::endl;
+      }
+   }
+
+   template<class T>
+   void ProcessResults(std::vector<T>& problems, ProblemSetHeader& header)
+   {
+      std::chrono::high_resolution_clock::time_point tNow = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(tNow - header.tStart);
+      header.time = static_cast<int>(std::round(1000 * time_span.count()));
+
+      int nMistakes = 0;
+
+      for (int i = 0; i < header.problem_count; i++)
+      {
+         T& theProblem = problems[i];
+
+         if ((theProblem.student_answer != theProblem.correct_answer))
+         {
+            nMistakes++;
+            ReportMistake(theProblem, i);
+         }
+
+         RecordLatency(theProblem, header);
+      }
+
+      header.test_mistakes = nMistakes;
+      ReportSummary(nMistakes);
+      ReportLatency(header);
+   }
+
+   // Checks solved problems in input order and reports them. Report rows go
+   // to a temporary file until the header (time and mistakes) is known, so
+   // no problem has to be kept after it is added.
+   class ProblemSetReport
+   {
+   public:
+      ProblemSetReport(int problem_set_id, ProblemSetHeader& header,
+                       ITable* psAdapter, const char* outputFilename, const char* comments);
+
+      template<class T>
+      void Add(const T& theProblem, ITable* prOutAdapter, size_t row);
+
+      void Finish(double seconds);
+
+   private:
+      int problem_set_id;
+      ProblemSetHeader& header;
+      ITable* psAdapter;
+      const char* outputFilename;
+      const char* comments;
+
+      std::string rowsFilename;
+      std::ofstream rows;
+      int nProblems;
+      int nMistakes;
+   };
+
+   ProblemSetReport::ProblemSetReport(int problem_set_id, ProblemSetHeader& header,
+                                      ITable* psAdapter, const char* outputFilename, const char* comments) :
+      problem_set_id(problem_set_id), header(header), psAdapter(psAdapter),
+      outputFilename(outputFilename), comments(comments), nProblems(0), nMistakes(0)
+   {
+      ExitIfConditionFails(!header.student_name.empty (), "Please, enter your name in 'GetStudentName' function.");
+
+      if (outputFilename != nullptr)
+      {
+         rowsFilename.assign(outputFilename).append(".rows");
+         rows.open(rowsFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+         ExitIfConditionFails(rows.good(), "Cannot open output file!");
       }
-      else if (firstChar == '-')
+   }
+
+   template<class T>
+   void ProblemSetReport::Add(const T& theProblem, ITable* prOutAdapter, size_t row)
+   {
+      ExitIfConditionFails(header.id == problem_set_id, "Wrong problem set. Check problem set number.");
+      ExitIfConditionFails(theProblem.id == (nProblems + 1), "Input file is corrupted.");
+
+      if ((theProblem.student_answer != theProblem.correct_answer))
       {
-         CheckCondition(!isHeaderSection, "Invalid entry in the header section.");
+         nMistakes++;
+         ReportMistake(theProblem, nProblems);
+      }
 
-         size_t row;
-         pTable->NewRow(row);
-         s.RemovePrefix(1);
+      RecordLatency(theProblem, header);
 
-         s.Trim();
-         if (s.IsEmpty()) return;
+      if (rows.is_open())
+      {
+         WriteRecordToStream(rows, prOutAdapter, row, true, true);
       }
 
-      StringSegment prefix(s);
-      s.Split(':', prefix);
-      s.Trim();
-      prefix.Trim();
+      nProblems++;
+   }
 
-      CheckCondition(!s.IsEmpty() && !prefix.IsEmpty(), "Key or value is empty.");
-      if (!IsOK()) return;
+   void ProblemSetReport::Finish(double seconds)
+   {
+      ExitIfConditionFails(header.id == problem_set_id, "Wrong problem set. Check problem set number.");
+      ExitIfConditionFails(header.problem_count == nProblems, "Input file is corrupted.");
 
-      if (isHeaderSection)
+      header.time = static_cast<int>(std::round(1000 * seconds));
+      header.test_mistakes = nMistakes;
+      ReportSummary(nMistakes);
+      ReportLatency(header);
+
+      if (outputFilename == nullptr) return;
+
+      rows.close();
+      ExitIfConditionFails(rows.good(), "Cannot open output file!");
+
+      std::ofstream out;
+      out.open(outputFilename);
+      ExitIfConditionFails(out.good(), "Cannot open output file!");
+
+      if (comments != nullptr)
       {
-         CheckCondition(pHeader != nullptr, "Unexpected header.");
-         if (!IsOK()) return;
+         out << comments;
+      }
 
-         bool bResult = pHeader->SetValue(0, prefix, s);
+      //same layout as WriteTableToStream
+      WriteRecordToStream(out, psAdapter, 0, true, false);
+      out << std::endl << "data:" << std::endl;
 
-         CheckCondition(bResult, "Cannot parse a line.");
-         if (!IsOK()) return;
+      std::ifstream rowsIn(rowsFilename, std::ios::in | std::ios::binary);
+      if (rowsIn.peek() != std::ifstream::traits_type::eof())
+      {
+         out << rowsIn.rdbuf();
       }
-      else
+      rowsIn.close();
+
+      out.close();
+      std::remove(rowsFilename.c_str());
+   }
+
+   // Parses, solves, checks and reports one problem at a time, so memory is
+   // bounded by the largest record rather than the whole problem set. The
+   // problems vector holds only the current problem. The time is the total
+   // time spent in solve, as the solving loop measures it in the regular mode.
+   template<class T, class Solver>
+   void SolveProblemSetStreaming(int problem_set_id, const char* inputFilename,
+                                 BasicYamlParser& parser, ProblemSetHeader& header,
+                                 std::vector<T>& problems, Solver solve,
+                                 ITable* psAdapter, ITable* prOutAdapter,
+                                 const char* outputFilename, const char* comments)
+   {
+      ProblemSetReport report(problem_set_id, header, psAdapter, outputFilename, comments);
+      int64_t solveTime = 0;
+
+      problems.clear();
+      auto onRecord = [&](size_t row)
       {
-         size_t tableSize = pTable->RowCount();
-         bool bResult = pTable->SetValue(tableSize - 1, prefix, s);
+         T& theProblem = problems[row];
 
-         CheckCondition(bResult, "Cannot parse a line.");
-         if (!IsOK()) return;
-      }
+         SolveAndTime(theProblem, solve);
+         solveTime += theProblem.solve_time;
+
+         report.Add(theProblem, prOutAdapter, row);
+         problems.clear();
+      };
+
+      parser.ParseFileStreaming(inputFilename, onRecord, true);
+      report.Finish(solveTime / 1e9);
    }
 
-   void WriteRecordToStream(std::ostream& out, ITable* table,
-                            size_t row, bool bWriteDefaultValues,
-                            bool bIndent)
+   struct WorkerStats
    {
-      if (bIndent) out << std::endl;
+      size_t problems = 0;
+      double seconds = 0;   // wall time until the worker ran out of work
+   };
 
-      size_t nCols = table->ColumnCount();
-      for (size_t j = 0; j < nCols; j++)
+   // Range of problem indices owned by one worker, packed as (begin << 32) | end
+   // so that the owner and thieves can update it with a single CAS
+   struct WorkRange
+   {
+      std::atomic<uint64_t> bounds;
+      char padding[64 - sizeof(std::atomic<uint64_t>)]; // one cache line per worker
+
+      static uint64_t Pack(size_t begin, size_t end)
       {
-          if (bIndent && (j == 0))
+         return (static_cast<uint64_t>(begin) << 32) | static_cast<uint64_t>(end);
+      }
+
+      // The owner takes a chunk from the front; chunks shrink with the range
+      bool TakeChunk(size_t& first, size_t& last)
+      {
+         uint64_t value = bounds.load(std::memory_order_acquire);
+
+         for (;;)
          {
-            out << " - ";
+            size_t begin = static_cast<size_t>(value >> 32);
+            size_t end = static_cast<size_t>(value & 0xFFFFFFFFu);
+            if (begin >= end) return false;
+
+            size_t chunk = std::max<size_t>(1, (end - begin) / 4);
+            if (bounds.compare_exchange_weak(value, Pack(begin + chunk, end), std::memory_order_acq_rel))
+            {
+               first = begin;
+               last = begin + chunk;
+               return true;
+            }
          }
+      }
 
-         if (bWriteDefaultValues || !table->EqualsDefaultValue(row, j))
+      // A thief takes the back half
+      bool StealHalf(size_t& first, size_t& last)
+      {
+         uint64_t value = bounds.load(std::memory_order_acquire);
+
+         for (;;)
          {
-            if (bIndent && (j != 0))
+            size_t begin = static_cast<size_t>(value >> 32);
+            size_t end = static_cast<size_t>(value & 0xFFFFFFFFu);
+            if (begin >= end) return false;
+
+            size_t middle = begin + (end - begin) / 2;
+            if (bounds.compare_exchange_weak(value, Pack(begin, middle), std::memory_order_acq_rel))
             {
-               out << "   ";
+               first = middle;
+               last = end;
+               return true;
             }
-
-            out << table->GetColumnName(j) << ": ";
-            std::string value;
-            table->GetValue(row, j, value);
-            out << value << std::endl;
          }
       }
-   }
+   };
 
-   void WriteTableToStream(std::ostream& out, ITable* table, ITable* header /* can be nullptr */,
-                           bool bWriteDefaultValues)
+   // Calls solve(problems[i]) for every problem on a pool of nThreads
+   // threads (0 means one per hardware thread), the calling thread included.
+   // Each worker starts with an equal share of the indices and takes chunks
+   // from it; an idle worker steals half of another worker's remaining range.
+   // Every problem is solved exactly once and its answer and solve time are
+   // written in place, so the results do not depend on the schedule.
+   template<class T, class Solver>
+   std::vector<WorkerStats> ParallelSolve(std::vector<T>& problems, Solver solve, size_t nThreads = 0)
    {
-      assert(table != nullptr);
+      if (nThreads == 0)
+      {
+         nThreads = std::max(1u, std::thread::hardware_concurrency());
+      }
 
-      size_t nRows = table->RowCount();
+      size_t nProblems = problems.size();
+      assert(nProblems < (static_cast<uint64_t>(1) << 32));
+      nThreads = std::max<size_t>(1, std::min(nThreads, nProblems));
 
-      if (header != nullptr)
+      std::unique_ptr<WorkRange[]> ranges(new WorkRange[nThreads]);
+      for (size_t id = 0; id < nThreads; id++)
       {
-         WriteRecordToStream(out, header, 0, bWriteDefaultValues, false);
+         ranges[id].bounds.store(WorkRange::Pack(nProblems * id / nThreads, nProblems * (id + 1) / nThreads));
       }
 
-      out << std::endl << "data:" << std::endl;
-      for (size_t i = 0; i < nRows; i++)
+      std::vector<WorkerStats> stats(nThreads);
+      auto work = [&](size_t id)
       {
-         WriteRecordToStream(out, table, i, bWriteDefaultValues, true);
+         std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+         size_t first = 0;
+         size_t last = 0;
+
+         for (;;)
+         {
+            if (!ranges[id].TakeChunk(first, last))
+            {
+               bool isStolen = false;
+               for (size_t k = 1; (k < nThreads) && !isStolen; k++)
+               {
+                  isStolen = ranges[(id + k) % nThreads].StealHalf(first, last);
+               }
+
+               if (!isStolen) break;
+
+               //the rest of the stolen range can be stolen again
+               ranges[id].bounds.store(WorkRange::Pack(first + 1, last), std::memory_order_release);
+               last = first + 1;
+            }
+
+            for (size_t i = first; i < last; i++)
+            {
+               SolveAndTime(problems[i], solve);
+            }
+            stats[id].problems += last - first;
+         }
+
+         std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - tStart;
+         stats[id].seconds = wallTime.count();
+      };
+
+      std::vector<std::thread> workers;
+      for (size_t id = 1; id < nThreads; id++)
+      {
+         workers.emplace_back(work, id);
+      }
+
+      work(0);
+
+      for (auto& worker : workers)
+      {
+         worker.join();
       }
+
+      return stats;
    }
 
-   void WriteTableToFile(const char* filename, ITable* header, ITable* table,
-                         bool bWriteDefaultValues, const char* comments)
+   void ReportWorkerStats(const std::vector<WorkerStats>& stats)
    {
-      std::ofstream out;
-      out.open(filename);
-      ExitIfConditionFails(out.good(), "Cannot open output file!");
+      if (stats.size() < 2) return;
 
-      if (comments != nullptr)
+      for (size_t id = 0; id < stats.size(); id++)
       {
-         out << comments;
+         std::cout << "Worker #" << (id + 1) << ": " << stats[id].problems << " problem(s) in "
+                   << static_cast<int>(std::round(1000 * stats[id].seconds)) << " ms." << std::endl;
       }
+   }
 
-      WriteTableToStream(out, header, table, bWriteDefaultValues);
+   // Bounded lock-free queue for any number of producers and consumers
+   // (D. Vyukov's design): each cell carries a sequence number that tells
+   // whether it is free for the producer at a position or full for the
+   // consumer at it. Push waits while the queue is full, which is what
+   // holds back a stage that runs ahead of the next one.
+   template<class T>
+   class BoundedQueue
+   {
+   public:
+      explicit BoundedQueue(size_t minCapacity);
 
-      out.close();
+      bool TryPush(T& value);
+      bool TryPop(T& value);
+
+      void Push(T& value);
+      bool Pop(T& value);    // false once the queue is closed and empty
+      void Close();
+
+   private:
+      struct Cell
+      {
+         std::atomic<size_t> sequence;
+         T value;
+      };
+
+   private:
+      std::unique_ptr<Cell[]> cells;
+      size_t mask;
+      alignas(64) std::atomic<size_t> enqueuePos;
+      alignas(64) std::atomic<size_t> dequeuePos;
+      std::atomic<bool> isClosed;
+   };
+
+   template<class T>
+   BoundedQueue<T>::BoundedQueue(size_t minCapacity) : enqueuePos(0), dequeuePos(0), isClosed(false)
+   {
+      size_t capacity = 2;
+      while (capacity < minCapacity) capacity *= 2;
+
+      cells.reset(new Cell[capacity]);
+      mask = capacity - 1;
+
+      for (size_t i = 0; i < capacity; i++)
+      {
+         cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
    }
 
    template<class T>
-   void PreprocessProblemSet(int problem_set_id, std::vector<T>& problems, ProblemSetHeader& header)
+   bool BoundedQueue<T>::TryPush(T& value)
    {
-      ExitIfConditionFails(header.id == problem_set_id, "Wrong problem set. Check problem set number.");
-      ExitIfConditionFails(header.problem_count == (int) problems.size(), "Input file is corrupted.");
-      ExitIfConditionFails(!header.student_name.empty (), "Please, enter your name in 'GetStudentName' function.");
+      size_t pos = enqueuePos.load(std::memory_order_relaxed);
 
-      for (int i = 0; i < header.problem_count; i++)
+      for (;;)
       {
-         ExitIfConditionFails(problems[i].id == (i + 1), "Input file is corrupted.");
+         Cell& cell = cells[pos & mask];
+         size_t sequence = cell.sequence.load(std::memory_order_acquire);
+         intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+         if (diff == 0)
+         {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               cell.value = std::move(value);
+               cell.sequence.store(pos + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (diff < 0)
+         {
+            return false; /* full */
+         }
+         else
+         {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+         }
       }
+   }
 
-      header.tStart = std::chrono::high_resolution_clock::now();
+   template<class T>
+   bool BoundedQueue<T>::TryPop(T& value)
+   {
+      size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+      for (;;)
+      {
+         Cell& cell = cells[pos & mask];
+         size_t sequence = cell.sequence.load(std::memory_order_acquire);
+         intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+         if (diff == 0)
+         {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               value = std::move(cell.value);
+               cell.sequence.store(pos + mask + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (diff < 0)
+         {
+            return false; /* empty */
+         }
+         else
+         {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+         }
+      }
    }
 
    template<class T>
-   void ProcessResults(std::vector<T>& problems, ProblemSetHeader& header)
+   void BoundedQueue<T>::Push(T& value)
    {
-      std::chrono::high_resolution_clock::time_point tNow = std::chrono::high_resolution_clock::now();
-      std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(tNow - header.tStart);
-      header.time = static_cast<int>(std::round(1000 * time_span.count()));
+      while (!TryPush(value))
+      {
+         std::this_thread::yield();
+      }
+   }
 
-      int nMistakes = 0;
+   template<class T>
+   bool BoundedQueue<T>::Pop(T& value)
+   {
+      for (;;)
+      {
+         if (TryPop(value)) return true;
 
-      for (int i = 0; i < header.problem_count; i++)
+         //values pushed before Close are still delivered
+         if (isClosed.load(std::memory_order_acquire)) return TryPop(value);
+
+         std::this_thread::yield();
+      }
+   }
+
+   template<class T>
+   void BoundedQueue<T>::Close()
+   {
+      isClosed.store(true, std::memory_order_release);
+   }
+
+   // Runs the problem set as a pipeline: a parser thread, nWorkers solver
+   // threads and the calling thread as the writer, connected by bounded
+   // queues. Problems carry their position in the file, and the writer
+   // reorders them, so checks, messages and the report come out in input
+   // order exactly as in the streaming mode. At most 'window' problems are in
+   // flight; the parser waits when it gets that far ahead of the writer. The
+   // time is the wall time of the whole pipeline, since solves overlap.
+   template<class T, class Solver>
+   void SolveProblemSetPipelined(int problem_set_id, const char* inputFilename,
+                                 BasicYamlParser& parser, ProblemSetHeader& header,
+                                 std::vector<T>& problems, Solver solve,
+                                 ITable* psAdapter, TableAdapter<T>* prOutAdapter,
+                                 const char* outputFilename, const char* comments,
+                                 size_t nWorkers = 0)
+   {
+      struct Item
       {
-         T& theProblem = problems[i];
+         size_t seq;
+         T problem;
+      };
 
-         if ((theProblem.student_answer != theProblem.correct_answer))
+      if (nWorkers == 0)
+      {
+         nWorkers = std::max(1u, std::thread::hardware_concurrency());
+      }
+
+      const size_t window = std::max<size_t>(64, 4 * nWorkers);
+
+      ProblemSetReport report(problem_set_id, header, psAdapter, outputFilename, comments);
+      std::chrono::high_resolution_clock::time_point tStart = std::chrono::high_resolution_clock::now();
+
+      BoundedQueue<Item> parsed(window);
+      BoundedQueue<Item> solved(window);
+      std::atomic<size_t> nWritten(0);
+      std::atomic<size_t> nActiveWorkers(nWorkers);
+
+      std::thread parserThread([&]()
+      {
+         size_t seq = 0;
+         Item item;
+
+         problems.clear();
+         auto onRecord = [&](size_t row)
          {
-            nMistakes++;
-            std::cout << std::endl;
-            std::cout << "Mistake in problem #" << (i + 1) << "." << std::endl;
-            std::cout << "Correct answer: " << theProblem.correct_answer << "." << std::endl;
-            std::cout << "Your answer: " << theProblem.student_answer << "." << std::endl;
-            std::cout << "=========================";
-         }
+            //keep the writer's reorder window bounded
+            while (seq >= nWritten.load(std::memory_order_acquire) + window)
+            {
+               std::this_thread::yield();
+            }
+
+            item.seq = seq++;
+            item.problem = std::move(problems[row]);
+            parsed.Push(item);
+            problems.clear();
+         };
+
+         parser.ParseFileStreaming(inputFilename, onRecord, true);
+         parsed.Close();
+      });
+
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < nWorkers; i++)
+      {
+         workers.emplace_back([&]()
+         {
+            Item item;
+            while (parsed.Pop(item))
+            {
+               SolveAndTime(item.problem, solve);
+               solved.Push(item);
+            }
+
+            if (nActiveWorkers.fetch_sub(1) == 1)
+            {
+               solved.Close();
+            }
+         });
       }
 
-      header.test_mistakes = nMistakes;
+      //writer: problems arrive in any order and leave in input order
+      std::vector<T> current(1);
+      TableAdapter<T> outAdapter(current, *prOutAdapter);
 
-      if (nMistakes > 0)
+      std::vector<Item> pending(window);
+      std::vector<char> isPending(window, 0);
+      size_t nextSeq = 0;
+
+      Item item;
+      while (solved.Pop(item))
       {
-         std::cout << std::endl << "Your algorithm made " << nMistakes << " mistake(s)." << std::endl;
+         size_t slot = item.seq % window;
+         pending[slot] = std::move(item);
+         isPending[slot] = 1;
+
+         for (slot = nextSeq % window; isPending[slot]; slot = nextSeq % window)
+         {
+            current[0] = std::move(pending[slot].problem);
+            isPending[slot] = 0;
+
+            report.Add(current[0], &outAdapter, 0);
+            nWritten.store(++nextSeq, std::memory_order_release);
+         }
       }
-      else
+
+      parserThread.join();
+      for (auto& worker : workers)
       {
-         std::cout << "Your algorithm solved all test problems correctly. Congratulations!" << std::endl;
+         worker.join();
       }
+
+      std::chrono::duration<double> wallTime = std::chrono::high_resolution_clock::now() - tStart;
+      report.Finish(wallTime.count());
    }
 }
 